@@ -22,31 +22,283 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
-#include <cstdlib> // For rand()
 #include <cstring> // For memcpy, memset
 #include <ctime>   // For time()
 #include <distingnt/api.h>
 #include <distingnt/serialisation.h>
 #include <new>
+#include <utility> // For std::integer_sequence
 
 // --- Data Structures ---
 
 const int MAX_STEPS = 32; // The longest pattern has 32 steps
+const int kMaxStepOrder = 2 * MAX_STEPS; // Ping-pong plays the inner steps twice
 
-// Holds the sequence for each of the four drum tracks using fixed-size arrays.
+// Track indices, in display order
+enum {
+    kTrackKick,
+    kTrackSnare,
+    kTrackHihat,
+    kTrackGhost,
+    kTrackOpenHat, // Shares the hi-hat row on the display
+    kNumTracks
+};
+
+// Main snare hits on beats 2 and 4 of every bar; variations never touch these
+const uint32_t kBackbeatMask = (1u << 4) | (1u << 12) | (1u << 20) | (1u << 28);
+
+// Holds the sequence for each drum track as hit masks (bit n = step n).
 struct DrumPattern {
-    bool kick[MAX_STEPS];
-    bool snare[MAX_STEPS];
-    bool hihat[MAX_STEPS];
-    bool ghostSnare[MAX_STEPS];
+    uint32_t hits[kNumTracks];
     int steps; // Number of steps in the pattern
 };
 
+// --- Hit Mask Helpers ---
+
+// Packs a step table into a hit mask
+template <size_t N>
+static inline uint32_t packTrack(const bool (&steps)[N]) {
+    static_assert(N <= MAX_STEPS, "Track longer than MAX_STEPS");
+    uint32_t mask = 0;
+    for (size_t i = 0; i < N; i++) {
+        if (steps[i]) mask |= 1u << i;
+    }
+    return mask;
+}
+
+// Mask with one bit set for every step of a pattern of the given length
+static inline uint32_t stepsMask(int steps) {
+    return steps >= MAX_STEPS ? 0xFFFFFFFFu : (1u << steps) - 1;
+}
+
+// Cortex-M7 has no population count instruction, and __builtin_popcount
+// becomes a call into libgcc, so count bits in parallel within the word:
+// pairs, then nibbles, then sum the four bytes with one multiply.
+static inline int countHits(uint32_t mask) {
+    mask = mask - ((mask >> 1) & 0x55555555u);
+    mask = (mask & 0x33333333u) + ((mask >> 2) & 0x33333333u);
+    mask = (mask + (mask >> 4)) & 0x0F0F0F0Fu;
+    return (int) ((mask * 0x01010101u) >> 24);
+}
+
+// Returns the step of the k-th (0-based) hit in mask. k must be < countHits(mask).
+// Runs in at most k iterations, so selection never depends on luck.
+static inline int selectHit(uint32_t mask, int k) {
+    while (k-- > 0) {
+        mask &= mask - 1; // Drop the lowest hit
+    }
+    return __builtin_ctz(mask);
+}
+
+static inline bool samePattern(const DrumPattern &a, const DrumPattern &b) {
+    for (int t = 0; t < kNumTracks; t++) {
+        if (a.hits[t] != b.hits[t]) return false;
+    }
+    return a.steps == b.steps;
+}
+
+// Elektron-style trig conditions, stored as one code per step. A:B plays on the
+// A-th of every B pattern cycles; First plays only on the first cycle after a
+// reset; Fill and Not Fill follow the Fill parameter.
+enum {
+    kCondAlways,
+    kCond1of2,
+    kCond2of2,
+    kCond1of4,
+    kCond2of4,
+    kCond3of4,
+    kCond4of4,
+    kCondFirst,
+    kCondNotFirst,
+    kCondFill,
+    kCondNotFill,
+    kNumConditions
+};
+
+// Random number generator owned by each instance. It is the same LCG as
+// newlib's rand(), so seeded variations match earlier builds on the module,
+// but host tools can run many instances on separate threads.
+struct DnbRandom {
+    static const int kMax = 0x7FFFFFFF;
+
+    uint64_t state;
+
+    void seed(uint32_t s) {
+        state = s;
+    }
+
+    int next() {
+        state = state * 6364136223846793005ULL + 1;
+        return (int) ((state >> 32) & kMax);
+    }
+};
+
+// Fast generator for the probability checks: xorshift32, one stream per track
+// so one track's rolls never shift another's. Period 2^32 - 1; the state must
+// not be zero.
+static inline uint32_t nextGate(uint32_t &state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// Starting state of a track's stream, mixed from the instance seed so the
+// tracks start at unrelated points of the sequence
+static inline uint32_t gateSeed(uint32_t seed, int track) {
+    uint32_t z = seed + (uint32_t) (track + 1) * 0x9E3779B9u;
+    z = (z ^ (z >> 16)) * 0x85EBCA6Bu;
+    z = (z ^ (z >> 13)) * 0xC2B2AE35u;
+    z ^= z >> 16;
+    return z ? z : 1;
+}
+
+// Kinds of change generateVariation() can make to the base pattern
+enum {
+    kMutationCopyTrack, // Replace a track with the same track from another pattern
+    kMutationSlide,     // Slide a track's hits one step forward or back
+    kMutationRemoveHit, // Remove one hit from a track
+    kMutationSwapHits,  // Swap one step between two tracks
+    kNumMutationTypes
+};
+
+// One mutation known to change the current base pattern. For copies and slides
+// 'mask' is the track's new hits; for removes and swaps it is the set of steps
+// the change may be applied to, one of which is picked when it is used.
+struct Mutation {
+    uint8_t type;
+    uint8_t track;
+    uint8_t otherTrack; // Second track for swaps
+    uint32_t mask;
+};
+
+// 10 copy sources x 3 tracks, 3 x 2 slides, 3 removes and 3 swap pairs
+const int MAX_MUTATIONS = 42;
+
+// Similarity library: the built-in patterns followed by a ring of recently
+// generated variations and bred patterns
+const int NUM_BUILTIN_PATTERNS = 10;
+const int PATTERN_BANK_SIZE = 64;
+const int LIBRARY_SIZE = NUM_BUILTIN_PATTERNS + PATTERN_BANK_SIZE;
+const int RECENT_FINDS = 4; // Library patterns find similar/different skips
+
+const int kAmenPatternId = 8; // The built-in the break slicer's slices come from
+const int kNumSlices = 16; // One slice per 16th of the one-bar break
+
+// A gate waiting to start on one output
+struct TriggerEvent {
+    uint32_t time; // Sample it starts on
+    int length; // Gate length in samples; 0 cuts the gate short
+};
+
+// Gates queued for one output, in time order. Delayed outputs hold theirs for
+// up to the delay; early ones get theirs from the lookahead.
+const int kTriggerQueueSize = 8; // Must be a power of two
+
+struct TriggerQueue {
+    TriggerEvent events[kTriggerQueueSize];
+    uint32_t head; // Next event to play
+    uint32_t tail; // Where the next event goes
+};
+
+// The bass lane's pitch output, gliding between notes. Pitches are in
+// semitones, 16.16 fixed point, so a glide is one integer add per sample.
+struct BassLane {
+    int32_t pitch; // Pitch being played
+    int32_t target; // Pitch the glide is heading for
+    int32_t rate; // Glide per sample, signed
+    int gateSamples; // Samples left of the gate
+    TriggerQueue notes; // Event lengths hold the new target pitch
+    TriggerQueue gates;
+};
+
+// Sidechain duck envelope stages
+enum {
+    kDuckIdle, // Fully released; the output holds at rest
+    kDuckAttack,
+    kDuckRelease,
+};
+
+// The sidechain duck: an attack/release envelope started by each kick
+struct DuckEnvelope {
+    float level; // 0 = at rest, 1 = fully ducked
+    int stage; // kDuck*
+    TriggerQueue hits; // Kicks, queued with the kick gate
+};
+
+// Internal clock. Taps are averaged over the last few, leaving out any more
+// than a fifth off their median, and a pause of two seconds starts over.
+const int kMinTempo = 40; // BPM
+const int kMaxTempo = 300;
+const int kMaxTaps = 8;
+const int kTapTimeoutMs = 2000;
+const int kTapTolerance = 5; // Intervals within 1/5 of the median count
+
+// MIDI realtime bytes waiting for step(), each stamped with the CPU cycle
+// count it arrived at. midiRealtime() writes the tail and step() the head, so
+// neither waits on the other.
+const int kMidiQueueSize = 32; // Must be a power of two
+
+struct MidiEvent {
+    uint32_t cycles; // NT_getCpuCycleCount() when it arrived
+    uint8_t byte;
+};
+
+struct MidiQueue {
+    MidiEvent events[kMidiQueueSize];
+    uint32_t head; // Next byte to read
+    uint32_t tail; // Where the next byte goes
+};
+
+// MIDI notes step() has queued, sent once the block is done so MIDI never
+// holds up the loop. step() writes the tail and the flush the head.
+const int kMidiOutQueueSize = 32; // Must be a power of two
+
+struct MidiMessage {
+    uint8_t status;
+    uint8_t data1;
+    uint8_t data2;
+};
+
+struct MidiOutQueue {
+    MidiMessage messages[kMidiOutQueueSize];
+    uint32_t head; // Next message to send
+    uint32_t tail; // Where the next message goes
+};
+
+// The sync bus a leader writes each block for its followers. It is a packet,
+// not a CV: small integers, exact in a float, from the start of the block.
+enum {
+    kSyncMagic, // kSyncMagicValue when a leader wrote this block
+    kSyncStep, // Leader's place in its step order at the start of the block
+    kSyncPulse, // Pulse within that step
+    kSyncBar, // Pattern cycles since the last reset
+    kSyncNumEdges, // Clock and reset edges in the block, which follow
+    kSyncHeaderSize
+};
+
+const int kSyncMagicValue = 0x5EC;
+const int kMaxSyncEdges = 8; // Per block; a clock edge is at least two samples
+
+// Lookahead states; see step()
+enum {
+    kLookaheadIdle,
+    kLookaheadWaiting, // The next step will be decided at lookaheadDue
+    kLookaheadDecided, // lookaheadFired holds the next step's tracks
+};
+
 // Main algorithm state, stored in DTC memory for persistence.
 struct _DnbSeqAlgorithm_DTC {
     DrumPattern currentPattern;
     DrumPattern basePattern; // The original, unmodified pattern
     int currentStep;
+
+    // The steps in the order the direction plays them, rebuilt between blocks
+    // when the direction or pattern length changes. A cycle is one pass.
+    uint8_t stepOrder[kMaxStepOrder];
+    int orderLength;
+    int orderIndex; // Where currentStep is in the order
+    int orderSteps, orderDirection, orderSeed; // What the order was built for
     int pulsesPerStep; // Pulses per 16th note = 6 for 24ppqn
     int pulseCount;
 
@@ -57,35 +309,204 @@ struct _DnbSeqAlgorithm_DTC {
     int queuedPatternId; // -1 = no pattern queued
     bool patternChangeQueued;
 
-    // Counters for gate duration
-    int kickTriggerSamples;
-    int snareTriggerSamples;
-    int hihatTriggerSamples;
-    int ghostTriggerSamples;
+    // Output gates, one per track. The open hat runs until choked by the
+    // closed hat; the others are cut at the next step.
+    int gateSamples[kNumTracks]; // Samples left of the gate playing
+    TriggerQueue triggers[kNumTracks];
+
+    // Clock measurement and lookahead for outputs that fire early
+    uint32_t lastClockSample; // When the last clock edge arrived
+    uint32_t clockPeriod; // Samples between the last two edges, 0 = unknown
+    int lookaheadState; // kLookahead*
+    uint32_t lookaheadDue; // When to decide the next step
+    uint32_t lookaheadFired; // Tracks the next step fires, once decided
+
+    // Break slicer: the slice each step plays, and the CV and trigger outputs
+    uint8_t sliceMap[MAX_STEPS];
+    int slice; // Slice the CV output is holding
+    int sliceTrigSamples; // Samples left of the slice trigger
+    TriggerQueue sliceChanges; // Event lengths hold the new slice
+    TriggerQueue sliceTriggers;
+
+    BassLane bass;
+    DuckEnvelope duck;
+
+    // Live capture: hits are placed against the last step that fired
+    uint32_t lastFireSample; // When it fired
+    int lastFireIndex; // Where it was in the step order
+    bool captureHigh[kNumTracks];
+
+    DnbRandom rng; // Variations and breeding
+    uint32_t gateRng[kNumTracks]; // Probability checks, one stream per track
 
     // Custom UI state
     int currentSeed;
     float bdProbability; // 0.0-1.0 - kick drum trigger probability
     float snareProbability; // 0.0-1.0 - snare trigger probability
     float ghostProbability; // 0.0-1.0 - ghost snare trigger probability
-    // Note: HH always triggers when pattern hit is active (no muting)
+    float hihatProbability; // 0.0-1.0 - closed and open hat trigger probability
+    uint32_t gateThreshold[kNumTracks]; // The probabilities as 31-bit integers; see rollHit()
+
+    // Per-bar dice: probability checks rolled for a whole pattern cycle at once
+    uint32_t diceMask[kNumTracks]; // Steps whose probability check passed
+    int diceBarsLeft; // Bars to replay the current dice before rolling again
+    bool diceRerollPending; // Set from the UI when the dice settings change; rolled at the next bar
+
+    // Trig conditions, turned into per-track "active this bar" masks at each bar
+    uint8_t conditions[kNumTracks][MAX_STEPS]; // kCond* code per step
+    uint32_t conditionMask[kNumTracks]; // Steps whose condition passes this bar
+    int barCount; // Pattern cycles since the last reset
+
+    // Density macro, built from the ranks in the ITC tables
+    uint32_t keepMask[kNumTracks]; // Steps whose hits survive the threshold
+    uint32_t addMask[kNumTracks]; // Steps that gain a hit at the threshold
+    int densityThreshold; // Threshold the masks were built for, -1 = rebuild
+
+    uint32_t sampleCount; // Samples processed, timestamps recorded events
+    int densityCv; // Density CV in tenths of a volt, as last recorded
+
+    // CPU meter
+    uint32_t blockCycles; // CPU cycles per step() call, smoothed
+    uint32_t peakBlockCycles; // Most cycles any call took since the meter was turned on
+
+    // MIDI clock
+    MidiQueue midi;
+    uint32_t lastBlockCycles; // Cycle count at the start of the last step() call
+    bool midiRunning; // Between Start or Continue and Stop
+
+    // Internal clock
+    uint32_t internalPeriod; // Samples per 24 PPQN pulse, 16.16, published by the UI
+    int32_t internalPhase; // Where the next pulse falls from the start of the block, 16.16
+    float cyclesPerSample; // CPU cycles per sample, smoothed, for timing taps
+
+    // MIDI note output
+    MidiOutQueue midiOut;
+    uint32_t midiNotesOn; // Tracks with a note sounding, one bit per track
+    MidiMessage midiNoteOff[kNumTracks]; // The note off each of them needs
+    uint32_t midiNoteEnd[kNumTracks]; // Sample each of them ends at
+
+    // Leader: the edges step() saw this block, as sample * 2 + 1 for a reset
+    int syncEdges[kMaxSyncEdges];
+    int numSyncEdges;
+};
+
+// Lookup tables step() reads when the pattern or density changes, in ITC
+// memory so the audio path reads them without flash or SRAM wait states. All
+// of it is derived from the built-in patterns and the base pattern, so it is
+// rebuilt, never saved.
+struct _DnbSeqAlgorithm_ITC {
+    DrumPattern builtinPatterns[NUM_BUILTIN_PATTERNS]; // Packed once at construct
+    uint8_t sliceTracks[kNumSlices]; // Tracks the break plays in each slice, one bit per track
+
+    // Density macro: every step of every track has an importance rank, lower is
+    // more important. Pattern hits rank 0-127 and candidate extra hits 128-254,
+    // so a threshold of 127 plays the pattern exactly as written. Steps ranked
+    // kNeverAdd are never added.
+    uint8_t hitRank[kNumTracks][MAX_STEPS]; // Rank of a hit the pattern has
+    uint8_t addRank[kNumTracks][MAX_STEPS]; // Rank of a hit the pattern could gain
 };
 
+const int kMaxDensityThreshold = 254;
+const uint8_t kNeverAdd = 255;
+
+// Hits of a track after the density macro has removed or added steps
+static inline uint32_t densityHits(const _DnbSeqAlgorithm_DTC *dtc, int track) {
+    const uint32_t hits = dtc->currentPattern.hits[track];
+    return (hits & dtc->keepMask[track]) | (~hits & dtc->addMask[track]);
+}
+
+struct EventRecorder;
+struct _DnbSeqAlgorithm;
+
+// One compiled variant of the step() loop; see selectStepVariant()
+typedef void (*StepFunction)(_DnbSeqAlgorithm *pThis, float *busFrames, int numFrames);
+
 // The main algorithm class, stored in SRAM.
 struct _DnbSeqAlgorithm : public _NT_algorithm {
-    _DnbSeqAlgorithm(_DnbSeqAlgorithm_DTC *dtc_ptr) : dtc(dtc_ptr) {
+    _DnbSeqAlgorithm(_DnbSeqAlgorithm_DTC *dtc_ptr, _DnbSeqAlgorithm_ITC *itc_ptr)
+        : dtc(dtc_ptr), itc(itc_ptr) {
     }
 
     _DnbSeqAlgorithm_DTC *dtc;
+    _DnbSeqAlgorithm_ITC *itc;
+
+    // Valid mutations of the base pattern, rebuilt whenever it changes
+    Mutation mutations[MAX_MUTATIONS];
+    int numMutations;
+
+    // Patterns searched by "find similar" / "find different"
+    DrumPattern library[LIBRARY_SIZE];
+    int bankCount; // Generated patterns stored so far, up to PATTERN_BANK_SIZE
+    int bankNext; // Ring slot the next generated pattern goes in
+    int recentFinds[RECENT_FINDS]; // Library indices recently left or loaded, -1 if none
+    int recentNext;
+
+    EventRecorder *recorder; // In DRAM; null when the Recorder Size specification is 0
+    bool exportRecording; // Export Recording was triggered; the next preset save includes the recording
+
+    StepFunction stepVariant; // The step() loop for the features in use
+
+    // Clock and reset pulses made from MIDI clock or the sync bus for the
+    // current block, in SRAM after the algorithm
+    float *pulseClockFrames;
+    float *pulseResetFrames;
+
+    // Tap tempo, on the UI side only
+    uint32_t tapCycles[kMaxTaps]; // Cycle count of each tap, oldest first
+    int numTaps;
+    int tapTempo; // Tempo the last tap set, so parameterChanged() doesn't round its period
+    int tempoTenths; // Tempo shown on the display, in tenths of a BPM
 
     // Helper functions to manage patterns
+    void seedRandom(uint32_t seed);
+
     void generatePattern(int patternId);
 
+    void buildMutations();
+
+    void buildDensityRanks();
+
+    void updateDensity(int threshold);
+
     void generateVariation();
 
     void generateVariationWithSeed(int seed);
 
+    int breedPatterns(int parentA, int parentB);
+
+    void storeInBank(const DrumPattern &p);
+
+    bool findByDistance(bool mostDifferent);
+
     void resetToDefault();
+
+    void buildSliceMap();
+
+    void buildStepOrder();
+
+    void updateGateThresholds();
+
+    void rollDice();
+
+    void updateConditions();
+
+    void beginBar();
+
+    void startPatternCycle(bool fromReset);
+
+    void startRecording();
+
+    void record(int type, int index, int32_t value, int sampleOffset = 0);
+
+    void takeSnapshot();
+
+    void selectStepVariant();
+
+    void clearTriggers();
+
+    void publishTempo(uint32_t period);
+
+    void tap();
 };
 
 // --- Parameter Definitions ---
@@ -104,6 +525,135 @@ enum {
     kParamPatternSelect,
     kParamGenerateVariation,
     kParamResetToDefault,
+
+    // Playback Direction
+    kParamDirection,
+    kParamShuffleSeed,
+
+    // Probability Controls
+    kParamDiceMode,
+    kParamDiceLock,
+
+    // Trig Conditions
+    kParamCondTrack,
+    kParamCondStep,
+    kParamCondition,
+    kParamFill,
+
+    // Hi-hats
+    kParamHihatProbability,
+    kParamOpenHatOutput,
+    kParamOpenHatGate,
+
+    // Break Slicer
+    kParamSliceCvOutput,
+    kParamSliceTrigOutput,
+
+    // Bass Lane
+    kParamBassPitchOutput,
+    kParamBassGateOutput,
+    kParamBassSource,
+    kParamBassRiff,
+    kParamBassRoot,
+    kParamBassScale,
+    kParamBassOctave,
+    kParamBassGlide,
+    kParamBassGate,
+
+    // Sidechain Duck
+    kParamDuckOutput,
+    kParamDuckDepth,
+    kParamDuckAttack,
+    kParamDuckRelease,
+
+    // Clock
+    kParamClockSource,
+    kParamTempo,
+
+    // MIDI note output; a channel and note per track, in track order
+    kParamMidiDestination,
+    kParamMidiVelocity,
+    kParamKickMidiChannel,
+    kParamKickMidiNote,
+    kParamSnareMidiChannel,
+    kParamSnareMidiNote,
+    kParamHihatMidiChannel,
+    kParamHihatMidiNote,
+    kParamGhostMidiChannel,
+    kParamGhostMidiNote,
+    kParamOpenHatMidiChannel,
+    kParamOpenHatMidiNote,
+
+    // Sync
+    kParamSyncMode,
+    kParamSyncInput,
+    kParamSyncOutput,
+
+    // Density Macro
+    kParamDensity,
+    kParamDensityInput,
+
+    // Breeding
+    kParamBreedParentA,
+    kParamBreedParentB,
+    kParamBreed,
+
+    // Live capture, inputs in track order
+    kParamCapture,
+    kParamKickCaptureInput,
+    kParamSnareCaptureInput,
+    kParamHihatCaptureInput,
+    kParamGhostCaptureInput,
+    kParamOpenHatCaptureInput,
+
+    // Latency compensation, in track order
+    kParamKickOffset,
+    kParamSnareOffset,
+    kParamHihatOffset,
+    kParamGhostOffset,
+    kParamOpenHatOffset,
+
+    // Debug
+    kParamRecorder,
+    kParamCpuMeter,
+    kParamExportRecording,
+};
+
+// Where the clock comes from
+enum {
+    kClockCv, // Clock In and Reset In
+    kClockMidi, // MIDI clock, with Start as the reset
+    kClockInternal, // Free-running at the Tempo, set by hand or tapped; Reset In still resets
+};
+
+// The order a pattern's steps play in
+enum {
+    kDirectionForward,
+    kDirectionReverse,
+    kDirectionPingPong, // Forward then back, without repeating the end steps
+    kDirectionOddEven, // Steps 1, 3, 5... then 2, 4, 6...
+    kDirectionRandom, // A shuffle of every step, the same for each Shuffle Seed
+    kNumDirections,
+};
+
+// How an instance shares its timing with others
+enum {
+    kSyncOff,
+    kSyncLeader, // Writes its step, pulse, bar and edges to Sync Out
+    kSyncFollower, // Takes them from Sync In instead of its clock
+};
+
+// Where the MIDI note velocity comes from
+enum {
+    kVelocityFixed, // Every note at 100
+    kVelocityProbability, // The track's probability, so rarer hits play softer
+    kVelocityAccent, // Loud on the beat, softer off it, ghosts softest
+};
+
+// When probability checks are made
+enum {
+    kDicePerHit, // Roll each hit as it triggers
+    kDicePerBar, // Roll every step at the start of the pattern cycle
 };
 
 // Enum strings for the pattern selection
@@ -113,6 +663,65 @@ static char const *const enumStringsPatterns[] = {
     "Amen Break", "Neurofunk", nullptr
 };
 
+static char const *const enumStringsDice[] = {
+    "Per Hit", "Per Bar", nullptr
+};
+
+static char const *const enumStringsDirections[] = {
+    "Forward", "Reverse", "Ping-Pong", "Odd-Even", "Random", nullptr
+};
+
+static char const *const enumStringsTracks[] = {
+    "Kick", "Snare", "Hi-hat", "Ghost", "Open Hat", nullptr
+};
+
+static char const *const enumStringsBassSources[] = {
+    "Kick", "Riff", nullptr
+};
+
+static char const *const enumStringsBassRiffs[] = {
+    "Root", "Octaves", "Fifths", "Rolling", "Reese Walk", nullptr
+};
+
+static char const *const enumStringsNotes[] = {
+    "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B", nullptr
+};
+
+static char const *const enumStringsScales[] = {
+    "Chromatic", "Minor", "Major", "Dorian", "Phrygian", "Minor Pent", nullptr
+};
+
+static char const *const enumStringsClockSources[] = {
+    "CV", "MIDI", "Internal", nullptr
+};
+
+static char const *const enumStringsMidiDestinations[] = {
+    "Breakout", "Select Bus", "USB", "Internal", "All", nullptr
+};
+
+static const uint32_t midiDestinations[] = {
+    kNT_destinationBreakout, kNT_destinationSelectBus, kNT_destinationUSB, kNT_destinationInternal,
+    kNT_destinationBreakout | kNT_destinationSelectBus | kNT_destinationUSB | kNT_destinationInternal,
+};
+
+static char const *const enumStringsSyncModes[] = {
+    "Off", "Leader", "Follower", nullptr
+};
+
+static char const *const enumStringsVelocities[] = {
+    "Fixed", "Probability", "Accent", nullptr
+};
+
+static char const *const enumStringsMidiChannels[] = {
+    "Off", "1", "2", "3", "4", "5", "6", "7", "8",
+    "9", "10", "11", "12", "13", "14", "15", "16", nullptr
+};
+
+static char const *const enumStringsConditions[] = {
+    "Always", "1:2", "2:2", "1:4", "2:4", "3:4", "4:4",
+    "First", "Not First", "Fill", "Not Fill", nullptr
+};
+
 // Pattern names for display (without NULL terminator)
 static const char *const patternNames[] = {
     "Two-Step", "Delayed Two-Step", "Steppa", "Stompa",
@@ -131,7 +740,367 @@ static const _NT_parameter parameters[] = {
     NT_PARAMETER_CV_OUTPUT("Ghost Snare Out", 1, 18)
 
     {
-        .name = "Pattern",
+        .name = "Pattern",
+        .min = 0,
+        .max = 9,
+        .def = 0,
+        .unit = kNT_unitEnum,
+        .scaling = 0,
+        .enumStrings = enumStringsPatterns
+    },
+    {
+        .name = "Vary Pattern",
+        .min = 0,
+        .max = 1,
+        .def = 0,
+        .unit = kNT_unitEnum,
+        .scaling = 0,
+        .enumStrings = (char const *const[]){"Off", "Trigger", nullptr}
+    },
+    {
+        .name = "Reset Pattern",
+        .min = 0,
+        .max = 1,
+        .def = 0,
+        .unit = kNT_unitEnum,
+        .scaling = 0,
+        .enumStrings = (char const *const[]){"Off", "Trigger", nullptr}
+    },
+    {
+        .name = "Direction",
+        .min = 0,
+        .max = kNumDirections - 1,
+        .def = kDirectionForward,
+        .unit = kNT_unitEnum,
+        .scaling = 0,
+        .enumStrings = enumStringsDirections
+    },
+    {
+        .name = "Shuffle Seed",
+        .min = 0,
+        .max = 999,
+        .def = 1,
+        .unit = kNT_unitNone,
+        .scaling = 0,
+        .enumStrings = NULL
+    },
+    {
+        .name = "Dice",
+        .min = 0,
+        .max = 1,
+        .def = kDicePerHit,
+        .unit = kNT_unitEnum,
+        .scaling = 0,
+        .enumStrings = enumStringsDice
+    },
+    {
+        .name = "Dice Lock Bars",
+        .min = 1,
+        .max = 16,
+        .def = 1,
+        .unit = kNT_unitNone,
+        .scaling = 0,
+        .enumStrings = NULL
+    },
+    {
+        .name = "Cond Track",
+        .min = 0,
+        .max = kNumTracks - 1,
+        .def = 0,
+        .unit = kNT_unitEnum,
+        .scaling = 0,
+        .enumStrings = enumStringsTracks
+    },
+    {
+        .name = "Cond Step",
+        .min = 1,
+        .max = MAX_STEPS,
+        .def = 1,
+        .unit = kNT_unitNone,
+        .scaling = 0,
+        .enumStrings = NULL
+    },
+    {
+        .name = "Condition",
+        .min = 0,
+        .max = kNumConditions - 1,
+        .def = kCondAlways,
+        .unit = kNT_unitEnum,
+        .scaling = 0,
+        .enumStrings = enumStringsConditions
+    },
+    {
+        .name = "Fill",
+        .min = 0,
+        .max = 1,
+        .def = 0,
+        .unit = kNT_unitEnum,
+        .scaling = 0,
+        .enumStrings = (char const *const[]){"Off", "On", nullptr}
+    },
+    {
+        .name = "Hi-hat Prob",
+        .min = 0,
+        .max = 100,
+        .def = 100,
+        .unit = kNT_unitPercent,
+        .scaling = 0,
+        .enumStrings = NULL
+    },
+    NT_PARAMETER_CV_OUTPUT("Open Hat Out", 0, 0)
+    {
+        .name = "Open Hat Gate",
+        .min = 10,
+        .max = 1000,
+        .def = 150,
+        .unit = kNT_unitMs,
+        .scaling = 0,
+        .enumStrings = NULL
+    },
+    NT_PARAMETER_CV_OUTPUT("Slice CV Out", 0, 0)
+    NT_PARAMETER_CV_OUTPUT("Slice Trig Out", 0, 0)
+    NT_PARAMETER_CV_OUTPUT("Bass Pitch Out", 0, 0)
+    NT_PARAMETER_CV_OUTPUT("Bass Gate Out", 0, 0)
+    {
+        .name = "Bass Source",
+        .min = 0,
+        .max = 1,
+        .def = 0,
+        .unit = kNT_unitEnum,
+        .scaling = 0,
+        .enumStrings = enumStringsBassSources
+    },
+    {
+        .name = "Bass Riff",
+        .min = 0,
+        .max = 4,
+        .def = 0,
+        .unit = kNT_unitEnum,
+        .scaling = 0,
+        .enumStrings = enumStringsBassRiffs
+    },
+    {
+        .name = "Bass Root",
+        .min = 0,
+        .max = 11,
+        .def = 0,
+        .unit = kNT_unitEnum,
+        .scaling = 0,
+        .enumStrings = enumStringsNotes
+    },
+    {
+        .name = "Bass Scale",
+        .min = 0,
+        .max = 5,
+        .def = 1,
+        .unit = kNT_unitEnum,
+        .scaling = 0,
+        .enumStrings = enumStringsScales
+    },
+    {
+        .name = "Bass Octave",
+        .min = -3,
+        .max = 3,
+        .def = -1,
+        .unit = kNT_unitNone,
+        .scaling = 0,
+        .enumStrings = NULL
+    },
+    {
+        .name = "Bass Glide",
+        .min = 0,
+        .max = 1000,
+        .def = 0,
+        .unit = kNT_unitMs,
+        .scaling = 0,
+        .enumStrings = NULL
+    },
+    {
+        .name = "Bass Gate",
+        .min = 10,
+        .max = 1000,
+        .def = 100,
+        .unit = kNT_unitMs,
+        .scaling = 0,
+        .enumStrings = NULL
+    },
+    NT_PARAMETER_CV_OUTPUT("Duck Out", 0, 0)
+    {
+        .name = "Duck Depth",
+        .min = 0,
+        .max = 100,
+        .def = 100,
+        .unit = kNT_unitPercent,
+        .scaling = 0,
+        .enumStrings = NULL
+    },
+    {
+        .name = "Duck Attack",
+        .min = 0,
+        .max = 100,
+        .def = 2,
+        .unit = kNT_unitMs,
+        .scaling = 0,
+        .enumStrings = NULL
+    },
+    {
+        .name = "Duck Release",
+        .min = 10,
+        .max = 2000,
+        .def = 200,
+        .unit = kNT_unitMs,
+        .scaling = 0,
+        .enumStrings = NULL
+    },
+    {
+        .name = "Clock Source",
+        .min = 0,
+        .max = 2,
+        .def = kClockCv,
+        .unit = kNT_unitEnum,
+        .scaling = 0,
+        .enumStrings = enumStringsClockSources
+    },
+    {
+        .name = "Tempo",
+        .min = kMinTempo,
+        .max = kMaxTempo,
+        .def = 174,
+        .unit = kNT_unitBPM,
+        .scaling = 0,
+        .enumStrings = NULL
+    },
+    {
+        .name = "MIDI Dest",
+        .min = 0,
+        .max = 4,
+        .def = 0,
+        .unit = kNT_unitEnum,
+        .scaling = 0,
+        .enumStrings = enumStringsMidiDestinations
+    },
+    {
+        .name = "MIDI Velocity",
+        .min = 0,
+        .max = 2,
+        .def = kVelocityFixed,
+        .unit = kNT_unitEnum,
+        .scaling = 0,
+        .enumStrings = enumStringsVelocities
+    },
+    {
+        .name = "Kick MIDI Ch",
+        .min = 0,
+        .max = 16,
+        .def = 0,
+        .unit = kNT_unitEnum,
+        .scaling = 0,
+        .enumStrings = enumStringsMidiChannels
+    },
+    {
+        .name = "Kick Note",
+        .min = 0,
+        .max = 127,
+        .def = 36,
+        .unit = kNT_unitMIDINote,
+        .scaling = 0,
+        .enumStrings = NULL
+    },
+    {
+        .name = "Snare MIDI Ch",
+        .min = 0,
+        .max = 16,
+        .def = 0,
+        .unit = kNT_unitEnum,
+        .scaling = 0,
+        .enumStrings = enumStringsMidiChannels
+    },
+    {
+        .name = "Snare Note",
+        .min = 0,
+        .max = 127,
+        .def = 38,
+        .unit = kNT_unitMIDINote,
+        .scaling = 0,
+        .enumStrings = NULL
+    },
+    {
+        .name = "Hi-hat MIDI Ch",
+        .min = 0,
+        .max = 16,
+        .def = 0,
+        .unit = kNT_unitEnum,
+        .scaling = 0,
+        .enumStrings = enumStringsMidiChannels
+    },
+    {
+        .name = "Hi-hat Note",
+        .min = 0,
+        .max = 127,
+        .def = 42,
+        .unit = kNT_unitMIDINote,
+        .scaling = 0,
+        .enumStrings = NULL
+    },
+    {
+        .name = "Ghost MIDI Ch",
+        .min = 0,
+        .max = 16,
+        .def = 0,
+        .unit = kNT_unitEnum,
+        .scaling = 0,
+        .enumStrings = enumStringsMidiChannels
+    },
+    {
+        .name = "Ghost Note",
+        .min = 0,
+        .max = 127,
+        .def = 37,
+        .unit = kNT_unitMIDINote,
+        .scaling = 0,
+        .enumStrings = NULL
+    },
+    {
+        .name = "Open Hat MIDI Ch",
+        .min = 0,
+        .max = 16,
+        .def = 0,
+        .unit = kNT_unitEnum,
+        .scaling = 0,
+        .enumStrings = enumStringsMidiChannels
+    },
+    {
+        .name = "Open Hat Note",
+        .min = 0,
+        .max = 127,
+        .def = 46,
+        .unit = kNT_unitMIDINote,
+        .scaling = 0,
+        .enumStrings = NULL
+    },
+    {
+        .name = "Sync Mode",
+        .min = 0,
+        .max = 2,
+        .def = kSyncOff,
+        .unit = kNT_unitEnum,
+        .scaling = 0,
+        .enumStrings = enumStringsSyncModes
+    },
+    NT_PARAMETER_CV_INPUT("Sync In", 0, 0)
+    NT_PARAMETER_CV_OUTPUT("Sync Out", 0, 0)
+    {
+        .name = "Density",
+        .min = 0,
+        .max = 100,
+        .def = 50,
+        .unit = kNT_unitPercent,
+        .scaling = 0,
+        .enumStrings = NULL
+    },
+    NT_PARAMETER_CV_INPUT("Density CV In", 0, 0)
+    {
+        .name = "Breed A",
         .min = 0,
         .max = 9,
         .def = 0,
@@ -140,7 +1109,16 @@ static const _NT_parameter parameters[] = {
         .enumStrings = enumStringsPatterns
     },
     {
-        .name = "Vary Pattern",
+        .name = "Breed B",
+        .min = 0,
+        .max = 9,
+        .def = 8,
+        .unit = kNT_unitEnum,
+        .scaling = 0,
+        .enumStrings = enumStringsPatterns
+    },
+    {
+        .name = "Breed",
         .min = 0,
         .max = 1,
         .def = 0,
@@ -149,7 +1127,84 @@ static const _NT_parameter parameters[] = {
         .enumStrings = (char const *const[]){"Off", "Trigger", nullptr}
     },
     {
-        .name = "Reset Pattern",
+        .name = "Capture",
+        .min = 0,
+        .max = 1,
+        .def = 0,
+        .unit = kNT_unitEnum,
+        .scaling = 0,
+        .enumStrings = (char const *const[]){"Off", "On", nullptr}
+    },
+    NT_PARAMETER_CV_INPUT("Kick Capture In", 0, 0)
+    NT_PARAMETER_CV_INPUT("Snare Capture In", 0, 0)
+    NT_PARAMETER_CV_INPUT("Hi-hat Capture In", 0, 0)
+    NT_PARAMETER_CV_INPUT("Ghost Capture In", 0, 0)
+    NT_PARAMETER_CV_INPUT("Open Hat Capture In", 0, 0)
+    {
+        .name = "Kick Offset",
+        .min = -960,
+        .max = 960,
+        .def = 0,
+        .unit = kNT_unitFrames,
+        .scaling = 0,
+        .enumStrings = NULL
+    },
+    {
+        .name = "Snare Offset",
+        .min = -960,
+        .max = 960,
+        .def = 0,
+        .unit = kNT_unitFrames,
+        .scaling = 0,
+        .enumStrings = NULL
+    },
+    {
+        .name = "Hi-hat Offset",
+        .min = -960,
+        .max = 960,
+        .def = 0,
+        .unit = kNT_unitFrames,
+        .scaling = 0,
+        .enumStrings = NULL
+    },
+    {
+        .name = "Ghost Offset",
+        .min = -960,
+        .max = 960,
+        .def = 0,
+        .unit = kNT_unitFrames,
+        .scaling = 0,
+        .enumStrings = NULL
+    },
+    {
+        .name = "Open Hat Offset",
+        .min = -960,
+        .max = 960,
+        .def = 0,
+        .unit = kNT_unitFrames,
+        .scaling = 0,
+        .enumStrings = NULL
+    },
+    {
+        .name = "Recorder",
+        .min = 0,
+        .max = 1,
+        .def = 0,
+        .unit = kNT_unitEnum,
+        .scaling = 0,
+        .enumStrings = (char const *const[]){"Off", "On", nullptr}
+    },
+    {
+        .name = "CPU Meter",
+        .min = 0,
+        .max = 1,
+        .def = 0,
+        .unit = kNT_unitEnum,
+        .scaling = 0,
+        .enumStrings = (char const *const[]){"Off", "On", nullptr}
+    },
+    {
+        .name = "Export Recording",
         .min = 0,
         .max = 1,
         .def = 0,
@@ -160,18 +1215,59 @@ static const _NT_parameter parameters[] = {
 };
 
 // Parameter Pages for the UI
-static const uint8_t page1[] = {kParamPatternSelect};
-static const uint8_t page2[] = {kParamGenerateVariation, kParamResetToDefault};
-static const uint8_t page3[] = {
-    kParamClockInput, kParamResetInput,
+static const uint8_t page1[] = {kParamPatternSelect, kParamDensity, kParamDirection, kParamShuffleSeed};
+static const uint8_t page2[] = {
+    kParamGenerateVariation, kParamResetToDefault,
+    kParamDiceMode, kParamDiceLock,
+    kParamHihatProbability, kParamOpenHatGate
+};
+static const uint8_t page3[] = {kParamCondTrack, kParamCondStep, kParamCondition, kParamFill};
+static const uint8_t page4[] = {kParamBreedParentA, kParamBreedParentB, kParamBreed};
+static const uint8_t page5[] = {
+    kParamClockSource, kParamTempo, kParamClockInput, kParamResetInput, kParamDensityInput,
+    kParamSyncMode, kParamSyncInput, kParamSyncOutput,
     kParamKickOutput, kParamSnareOutput,
-    kParamHihatOutput, kParamGhostSnareOutput
+    kParamHihatOutput, kParamGhostSnareOutput,
+    kParamOpenHatOutput, kParamSliceCvOutput, kParamSliceTrigOutput
+};
+static const uint8_t page6[] = {
+    kParamCapture,
+    kParamKickCaptureInput, kParamSnareCaptureInput, kParamHihatCaptureInput,
+    kParamGhostCaptureInput, kParamOpenHatCaptureInput
+};
+static const uint8_t page7[] = {
+    kParamKickOffset, kParamSnareOffset, kParamHihatOffset,
+    kParamGhostOffset, kParamOpenHatOffset
 };
+static const uint8_t page8[] = {
+    kParamBassPitchOutput, kParamBassGateOutput,
+    kParamBassSource, kParamBassRiff,
+    kParamBassRoot, kParamBassScale, kParamBassOctave,
+    kParamBassGlide, kParamBassGate
+};
+static const uint8_t page9[] = {kParamDuckOutput, kParamDuckDepth, kParamDuckAttack, kParamDuckRelease};
+static const uint8_t page10[] = {
+    kParamMidiDestination, kParamMidiVelocity,
+    kParamKickMidiChannel, kParamKickMidiNote,
+    kParamSnareMidiChannel, kParamSnareMidiNote,
+    kParamHihatMidiChannel, kParamHihatMidiNote,
+    kParamGhostMidiChannel, kParamGhostMidiNote,
+    kParamOpenHatMidiChannel, kParamOpenHatMidiNote
+};
+static const uint8_t page11[] = {kParamRecorder, kParamExportRecording, kParamCpuMeter};
 
 static const _NT_parameterPage pages[] = {
     {.name = "Pattern", .numParams = ARRAY_SIZE(page1), .params = page1},
     {.name = "Modify", .numParams = ARRAY_SIZE(page2), .params = page2},
-    {.name = "Routing", .numParams = ARRAY_SIZE(page3), .params = page3},
+    {.name = "Conditions", .numParams = ARRAY_SIZE(page3), .params = page3},
+    {.name = "Breed", .numParams = ARRAY_SIZE(page4), .params = page4},
+    {.name = "Routing", .numParams = ARRAY_SIZE(page5), .params = page5},
+    {.name = "Capture", .numParams = ARRAY_SIZE(page6), .params = page6},
+    {.name = "Latency", .numParams = ARRAY_SIZE(page7), .params = page7},
+    {.name = "Bass", .numParams = ARRAY_SIZE(page8), .params = page8},
+    {.name = "Duck", .numParams = ARRAY_SIZE(page9), .params = page9},
+    {.name = "MIDI", .numParams = ARRAY_SIZE(page10), .params = page10},
+    {.name = "Debug", .numParams = ARRAY_SIZE(page11), .params = page11},
 };
 
 static const _NT_parameterPages parameterPages = {
@@ -179,12 +1275,79 @@ static const _NT_parameterPages parameterPages = {
     .pages = pages,
 };
 
+// --- Event Recorder ---
+
+// Kinds of event the recorder logs
+enum {
+    kEventClock, // Rising edge on the clock input
+    kEventReset, // Rising edge on the reset input
+    kEventParameter, // index = parameter, value = its new value
+    kEventUi, // index = lastButtons, value = controls | encoders << 16
+    kEventPot, // index = pot, value = float bits of its position
+    kEventDensityCv, // value = density CV in tenths of a volt
+    kEventSeed, // value = RNG seed
+    kEventStep, // index = step, value = tracks that fired; checked on replay
+    kEventCapture, // index = track, value = step a captured hit was added to
+    kEventSync, // index = place in the step order, value = pulse | bar << 8; a follower locked to its leader
+};
+
+// Specifications, chosen when the algorithm is added
+enum {
+    kSpecRecorderSize, // Event recorder ring, in 1024s of events; 0 leaves the recorder out
+};
+
+const int kMaxRecorderSize = 32;
+
+static const _NT_specification specifications[] = {
+    {.name = "Recorder Size", .min = 0, .max = kMaxRecorderSize, .def = 0, .type = kNT_typeGeneric},
+};
+
+// Events the recorder's ring holds for the specifications: the largest power
+// of two within the Recorder Size, or none
+static uint32_t recorderEvents(const int32_t *specifications) {
+    const uint32_t events = (uint32_t) specifications[kSpecRecorderSize] * 1024;
+    return events ? 1u << (31 - __builtin_clz(events)) : 0;
+}
+
+// seq is written last, as the event's index + 1, so a reader can tell a
+// complete event from one that is being overwritten
+struct RecordedEvent {
+    uint32_t seq;
+    uint32_t sample;
+    uint16_t type;
+    uint16_t index;
+    int32_t value;
+};
+
+// Everything needed to replay from eventIndex onwards. Mutations aren't kept;
+// they are rebuilt from the base pattern.
+struct RecorderSnapshot {
+    uint32_t eventIndex;
+    int16_t v[ARRAY_SIZE(parameters)];
+    _DnbSeqAlgorithm_DTC dtc;
+    DrumPattern bank[PATTERN_BANK_SIZE];
+    int bankCount;
+    int bankNext;
+};
+
+// Ring of the latest events, written without locks from step() and the UI.
+// A snapshot is taken at least every half ring, so the older of the two
+// always has its following events still in the ring. The events follow the
+// header in DRAM; their number is set by the Recorder Size specification.
+struct EventRecorder {
+    uint32_t writeIndex;
+    uint32_t numSnapshots;
+    uint32_t eventMask; // Events in the ring - 1; the ring is a power of two
+    bool snapshotPending;
+    RecorderSnapshot snapshots[2];
+    RecordedEvent *events;
+};
+
 // --- Pattern Generation Functions ---
 
-// Creates a pattern based on an ID
-void _DnbSeqAlgorithm::generatePattern(int patternId) {
-    DrumPattern p;
-    memset(&p, 0, sizeof(p)); // Clear the entire struct, setting arrays to false
+// Fills in one of the built-in patterns
+static void buildPattern(int patternId, DrumPattern &p) {
+    memset(&p, 0, sizeof(p)); // Clear the entire struct, leaving every track empty
     p.steps = 16; // Default for most patterns
 
     switch (patternId) {
@@ -193,9 +1356,11 @@ void _DnbSeqAlgorithm::generatePattern(int patternId) {
             const bool pat_k[] = {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0};
             const bool pat_s[] = {0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0};
             const bool pat_h[] = {1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0};
-            memcpy(p.kick, pat_k, sizeof(pat_k));
-            memcpy(p.snare, pat_s, sizeof(pat_s));
-            memcpy(p.hihat, pat_h, sizeof(pat_h));
+            const bool pat_o[] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0};
+            p.hits[kTrackKick] = packTrack(pat_k);
+            p.hits[kTrackSnare] = packTrack(pat_s);
+            p.hits[kTrackHihat] = packTrack(pat_h);
+            p.hits[kTrackOpenHat] = packTrack(pat_o);
             break;
         }
         case 1: {
@@ -203,9 +1368,9 @@ void _DnbSeqAlgorithm::generatePattern(int patternId) {
             const bool pat_k[] = {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0};
             const bool pat_s[] = {0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0};
             const bool pat_h[] = {1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0};
-            memcpy(p.kick, pat_k, sizeof(pat_k));
-            memcpy(p.snare, pat_s, sizeof(pat_s));
-            memcpy(p.hihat, pat_h, sizeof(pat_h));
+            p.hits[kTrackKick] = packTrack(pat_k);
+            p.hits[kTrackSnare] = packTrack(pat_s);
+            p.hits[kTrackHihat] = packTrack(pat_h);
             break;
         }
         case 2: {
@@ -213,11 +1378,13 @@ void _DnbSeqAlgorithm::generatePattern(int patternId) {
             const bool pat_k[] = {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
             const bool pat_s[] = {0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0};
             const bool pat_h[] = {1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0};
+            const bool pat_o[] = {0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1, 0};
             const bool pat_g[] = {0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 0, 0, 0, 1, 0, 1};
-            memcpy(p.kick, pat_k, sizeof(pat_k));
-            memcpy(p.snare, pat_s, sizeof(pat_s));
-            memcpy(p.hihat, pat_h, sizeof(pat_h));
-            memcpy(p.ghostSnare, pat_g, sizeof(pat_g));
+            p.hits[kTrackKick] = packTrack(pat_k);
+            p.hits[kTrackSnare] = packTrack(pat_s);
+            p.hits[kTrackHihat] = packTrack(pat_h);
+            p.hits[kTrackOpenHat] = packTrack(pat_o);
+            p.hits[kTrackGhost] = packTrack(pat_g);
             break;
         }
         case 3: {
@@ -226,10 +1393,10 @@ void _DnbSeqAlgorithm::generatePattern(int patternId) {
             const bool pat_s[] = {0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0};
             const bool pat_h[] = {1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0};
             const bool pat_g[] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1};
-            memcpy(p.kick, pat_k, sizeof(pat_k));
-            memcpy(p.snare, pat_s, sizeof(pat_s));
-            memcpy(p.hihat, pat_h, sizeof(pat_h));
-            memcpy(p.ghostSnare, pat_g, sizeof(pat_g));
+            p.hits[kTrackKick] = packTrack(pat_k);
+            p.hits[kTrackSnare] = packTrack(pat_s);
+            p.hits[kTrackHihat] = packTrack(pat_h);
+            p.hits[kTrackGhost] = packTrack(pat_g);
             break;
         }
         case 4: {
@@ -237,9 +1404,9 @@ void _DnbSeqAlgorithm::generatePattern(int patternId) {
             const bool pat_k[] = {1, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0};
             const bool pat_s[] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0};
             const bool pat_h[] = {1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0};
-            memcpy(p.kick, pat_k, sizeof(pat_k));
-            memcpy(p.snare, pat_s, sizeof(pat_s));
-            memcpy(p.hihat, pat_h, sizeof(pat_h));
+            p.hits[kTrackKick] = packTrack(pat_k);
+            p.hits[kTrackSnare] = packTrack(pat_s);
+            p.hits[kTrackHihat] = packTrack(pat_h);
             break;
         }
         case 5: {
@@ -257,9 +1424,9 @@ void _DnbSeqAlgorithm::generatePattern(int patternId) {
                 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0,
                 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0
             };
-            memcpy(p.kick, pat_k, sizeof(pat_k));
-            memcpy(p.snare, pat_s, sizeof(pat_s));
-            memcpy(p.hihat, pat_h, sizeof(pat_h));
+            p.hits[kTrackKick] = packTrack(pat_k);
+            p.hits[kTrackSnare] = packTrack(pat_s);
+            p.hits[kTrackHihat] = packTrack(pat_h);
             break;
         }
         case 6: {
@@ -267,9 +1434,11 @@ void _DnbSeqAlgorithm::generatePattern(int patternId) {
             const bool pat_k[] = {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
             const bool pat_s[] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0};
             const bool pat_h[] = {1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0};
-            memcpy(p.kick, pat_k, sizeof(pat_k));
-            memcpy(p.snare, pat_s, sizeof(pat_s));
-            memcpy(p.hihat, pat_h, sizeof(pat_h));
+            const bool pat_o[] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0};
+            p.hits[kTrackKick] = packTrack(pat_k);
+            p.hits[kTrackSnare] = packTrack(pat_s);
+            p.hits[kTrackHihat] = packTrack(pat_h);
+            p.hits[kTrackOpenHat] = packTrack(pat_o);
             break;
         }
         case 7: {
@@ -287,9 +1456,9 @@ void _DnbSeqAlgorithm::generatePattern(int patternId) {
                 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0,
                 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0
             };
-            memcpy(p.kick, pat_k, sizeof(pat_k));
-            memcpy(p.snare, pat_s, sizeof(pat_s));
-            memcpy(p.hihat, pat_h, sizeof(pat_h));
+            p.hits[kTrackKick] = packTrack(pat_k);
+            p.hits[kTrackSnare] = packTrack(pat_s);
+            p.hits[kTrackHihat] = packTrack(pat_h);
             break;
         }
         case 8: {
@@ -298,10 +1467,10 @@ void _DnbSeqAlgorithm::generatePattern(int patternId) {
             const bool pat_s[] = {0, 0, 0, 0, 1, 0, 0, 1, 0, 1, 0, 0, 1, 0, 0, 0};
             const bool pat_h[] = {1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0};
             const bool pat_g[] = {0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-            memcpy(p.kick, pat_k, sizeof(pat_k));
-            memcpy(p.snare, pat_s, sizeof(pat_s));
-            memcpy(p.hihat, pat_h, sizeof(pat_h));
-            memcpy(p.ghostSnare, pat_g, sizeof(pat_g));
+            p.hits[kTrackKick] = packTrack(pat_k);
+            p.hits[kTrackSnare] = packTrack(pat_s);
+            p.hits[kTrackHihat] = packTrack(pat_h);
+            p.hits[kTrackGhost] = packTrack(pat_g);
             break;
         }
         case 9: {
@@ -309,34 +1478,103 @@ void _DnbSeqAlgorithm::generatePattern(int patternId) {
             const bool pat_k[] = {1, 0, 0, 0, 0, 1, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0};
             const bool pat_s[] = {0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0};
             const bool pat_h[] = {1, 0, 1, 1, 1, 0, 1, 0, 1, 0, 1, 1, 1, 0, 1, 0};
+            const bool pat_o[] = {0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0};
             const bool pat_g[] = {0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0};
-            memcpy(p.kick, pat_k, sizeof(pat_k));
-            memcpy(p.snare, pat_s, sizeof(pat_s));
-            memcpy(p.hihat, pat_h, sizeof(pat_h));
-            memcpy(p.ghostSnare, pat_g, sizeof(pat_g));
+            p.hits[kTrackKick] = packTrack(pat_k);
+            p.hits[kTrackSnare] = packTrack(pat_s);
+            p.hits[kTrackHihat] = packTrack(pat_h);
+            p.hits[kTrackOpenHat] = packTrack(pat_o);
+            p.hits[kTrackGhost] = packTrack(pat_g);
             break;
         }
         default: break;
     }
+}
+
+// Seeds the variation generator and every track's probability stream
+void _DnbSeqAlgorithm::seedRandom(uint32_t seed) {
+    dtc->rng.seed(seed);
+    for (int track = 0; track < kNumTracks; track++) {
+        dtc->gateRng[track] = gateSeed(seed, track);
+    }
+    record(kEventSeed, 0, seed);
+}
+
+// Creates a pattern based on an ID
+void _DnbSeqAlgorithm::generatePattern(int patternId) {
+    const DrumPattern &p = itc->builtinPatterns[patternId];
 
     dtc->basePattern = p;
     dtc->currentPattern = p;
+    buildMutations();
+    buildDensityRanks();
+    buildSliceMap();
+}
+
+// Ranks every step of every track for the density macro, from its place in
+// the bar. Backbeat snares and the downbeat kick are never removed; ghosts go
+// first. Extra hits are offered as 8th then 16th hats, then ghost notes, then
+// offbeat kicks, and never land on the base pattern's snares.
+void _DnbSeqAlgorithm::buildDensityRanks() {
+    const DrumPattern &base = dtc->basePattern;
+    const int stepsPerBeat = (base.steps == 24) ? 6 : 4; // Triplet patterns
+    const int stepsPerBar = stepsPerBeat * 4;
+    const uint32_t occupied = base.hits[kTrackKick] | base.hits[kTrackSnare];
+
+    for (int step = 0; step < MAX_STEPS; step++) {
+        // 0 = bar downbeat, 1 = beat, 2 = 8th offbeat, 3 = anything finer
+        int beatPos = step % stepsPerBeat;
+        int level = (step % stepsPerBar == 0) ? 0
+                    : (beatPos == 0) ? 1
+                    : (beatPos * 2 == stepsPerBeat) ? 2 : 3;
+        bool backbeat = (step % stepsPerBar) == stepsPerBeat || (step % stepsPerBar) == 3 * stepsPerBeat;
+        bool free = !(occupied & (1u << step));
+
+        itc->hitRank[kTrackKick][step] = level == 0 ? 0 : 16 + level * 8;
+        itc->hitRank[kTrackSnare][step] = backbeat ? 0 : 24 + level * 8;
+        itc->hitRank[kTrackHihat][step] = 40 + level * 12;
+        itc->hitRank[kTrackOpenHat][step] = 56 + level * 8;
+        itc->hitRank[kTrackGhost][step] = 96 + level * 8;
+
+        itc->addRank[kTrackKick][step] = free ? (level <= 2 ? 200 : 224) : kNeverAdd;
+        itc->addRank[kTrackSnare][step] = kNeverAdd; // Never add snares over the backbeat
+        itc->addRank[kTrackHihat][step] = level <= 2 ? 128 : 144;
+        itc->addRank[kTrackOpenHat][step] = kNeverAdd;
+        itc->addRank[kTrackGhost][step] = free ? (level <= 2 ? 160 : 176) : kNeverAdd;
+    }
+    // Rebuild the masks straight away: a pattern applied at a cycle start can
+    // fire on the same sample, before the next block would rebuild them
+    if (dtc->densityThreshold >= 0) updateDensity(dtc->densityThreshold);
+}
+
+// Rebuilds the keep/add masks for a new threshold: one comparison per step,
+// no pattern regeneration, so density can be swept at block rate
+void _DnbSeqAlgorithm::updateDensity(int threshold) {
+    for (int track = 0; track < kNumTracks; track++) {
+        uint32_t keep = 0, add = 0;
+        for (int step = 0; step < MAX_STEPS; step++) {
+            if (itc->hitRank[track][step] <= threshold) keep |= 1u << step;
+            if (itc->addRank[track][step] <= threshold) add |= 1u << step;
+        }
+        dtc->keepMask[track] = keep;
+        dtc->addMask[track] = add;
+    }
+    dtc->densityThreshold = threshold;
 }
 
-// Helper function to get track from a pattern
-void getTrackFromPattern(int patternId, int track, bool *outTrack, int &outSteps) {
-    // Clear output track first
-    memset(outTrack, 0, MAX_STEPS * sizeof(bool));
-    
+// Helper function to get a donor track's hit mask from a pattern
+uint32_t getTrackFromPattern(int patternId, int track, int &outSteps) {
+    uint32_t mask = 0;
+
     switch (patternId) {
         case 0: { // Two-Step
             const bool pat_k[] = {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0};
             const bool pat_s[] = {0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0};
             const bool pat_g[] = {0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0};
             switch (track) {
-                case 0: memcpy(outTrack, pat_k, sizeof(pat_k)); break;
-                case 1: memcpy(outTrack, pat_s, sizeof(pat_s)); break;
-                case 3: memcpy(outTrack, pat_g, sizeof(pat_g)); break;
+                case 0: mask = packTrack(pat_k); break;
+                case 1: mask = packTrack(pat_s); break;
+                case 3: mask = packTrack(pat_g); break;
             }
             outSteps = 16;
             break;
@@ -346,9 +1584,9 @@ void getTrackFromPattern(int patternId, int track, bool *outTrack, int &outSteps
             const bool pat_s[] = {0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0};
             const bool pat_g[] = {0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0};
             switch (track) {
-                case 0: memcpy(outTrack, pat_k, sizeof(pat_k)); break;
-                case 1: memcpy(outTrack, pat_s, sizeof(pat_s)); break;
-                case 3: memcpy(outTrack, pat_g, sizeof(pat_g)); break;
+                case 0: mask = packTrack(pat_k); break;
+                case 1: mask = packTrack(pat_s); break;
+                case 3: mask = packTrack(pat_g); break;
             }
             outSteps = 16;
             break;
@@ -358,9 +1596,9 @@ void getTrackFromPattern(int patternId, int track, bool *outTrack, int &outSteps
             const bool pat_s[] = {0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0};
             const bool pat_g[] = {0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0};
             switch (track) {
-                case 0: memcpy(outTrack, pat_k, sizeof(pat_k)); break;
-                case 1: memcpy(outTrack, pat_s, sizeof(pat_s)); break;
-                case 3: memcpy(outTrack, pat_g, sizeof(pat_g)); break;
+                case 0: mask = packTrack(pat_k); break;
+                case 1: mask = packTrack(pat_s); break;
+                case 3: mask = packTrack(pat_g); break;
             }
             outSteps = 16;
             break;
@@ -370,9 +1608,9 @@ void getTrackFromPattern(int patternId, int track, bool *outTrack, int &outSteps
             const bool pat_s[] = {0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0};
             const bool pat_g[] = {0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0};
             switch (track) {
-                case 0: memcpy(outTrack, pat_k, sizeof(pat_k)); break;
-                case 1: memcpy(outTrack, pat_s, sizeof(pat_s)); break;
-                case 3: memcpy(outTrack, pat_g, sizeof(pat_g)); break;
+                case 0: mask = packTrack(pat_k); break;
+                case 1: mask = packTrack(pat_s); break;
+                case 3: mask = packTrack(pat_g); break;
             }
             outSteps = 16;
             break;
@@ -382,9 +1620,9 @@ void getTrackFromPattern(int patternId, int track, bool *outTrack, int &outSteps
             const bool pat_s[] = {0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0};
             const bool pat_g[] = {0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 0};
             switch (track) {
-                case 0: memcpy(outTrack, pat_k, sizeof(pat_k)); break;
-                case 1: memcpy(outTrack, pat_s, sizeof(pat_s)); break;
-                case 3: memcpy(outTrack, pat_g, sizeof(pat_g)); break;
+                case 0: mask = packTrack(pat_k); break;
+                case 1: mask = packTrack(pat_s); break;
+                case 3: mask = packTrack(pat_g); break;
             }
             outSteps = 16;
             break;
@@ -394,9 +1632,9 @@ void getTrackFromPattern(int patternId, int track, bool *outTrack, int &outSteps
             const bool pat_s[] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0};
             const bool pat_g[] = {0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0};
             switch (track) {
-                case 0: memcpy(outTrack, pat_k, sizeof(pat_k)); break;
-                case 1: memcpy(outTrack, pat_s, sizeof(pat_s)); break;
-                case 3: memcpy(outTrack, pat_g, sizeof(pat_g)); break;
+                case 0: mask = packTrack(pat_k); break;
+                case 1: mask = packTrack(pat_s); break;
+                case 3: mask = packTrack(pat_g); break;
             }
             outSteps = 16;
             break;
@@ -406,9 +1644,9 @@ void getTrackFromPattern(int patternId, int track, bool *outTrack, int &outSteps
             const bool pat_s[] = {0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 1, 0, 1, 0, 0, 0};
             const bool pat_g[] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
             switch (track) {
-                case 0: memcpy(outTrack, pat_k, sizeof(pat_k)); break;
-                case 1: memcpy(outTrack, pat_s, sizeof(pat_s)); break;
-                case 3: memcpy(outTrack, pat_g, sizeof(pat_g)); break;
+                case 0: mask = packTrack(pat_k); break;
+                case 1: mask = packTrack(pat_s); break;
+                case 3: mask = packTrack(pat_g); break;
             }
             outSteps = 16;
             break;
@@ -418,9 +1656,9 @@ void getTrackFromPattern(int patternId, int track, bool *outTrack, int &outSteps
             const bool pat_s[] = {0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0};
             const bool pat_g[] = {0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0};
             switch (track) {
-                case 0: memcpy(outTrack, pat_k, sizeof(pat_k)); break;
-                case 1: memcpy(outTrack, pat_s, sizeof(pat_s)); break;
-                case 3: memcpy(outTrack, pat_g, sizeof(pat_g)); break;
+                case 0: mask = packTrack(pat_k); break;
+                case 1: mask = packTrack(pat_s); break;
+                case 3: mask = packTrack(pat_g); break;
             }
             outSteps = 16;
             break;
@@ -429,164 +1667,126 @@ void getTrackFromPattern(int patternId, int track, bool *outTrack, int &outSteps
             outSteps = 16;
             break;
     }
+    return mask;
 }
 
-// Generates a random variation of the current pattern
-void _DnbSeqAlgorithm::generateVariation() {
-    DrumPattern variation = dtc->basePattern; // Start from the clean base pattern
-    
-    // Choose variation type: 0 = track copy, 1 = slide hits, 2 = remove hit, 3 = swap hits
-    int variationType = rand() % 4;
-    
-    if (variationType == 0) {
-        // Copy a track from another pattern of the same length
-        int sourceTrack = rand() % 3; // 0=kick, 1=snare, 2=ghost
-        if (sourceTrack >= 2) sourceTrack = 3; // Map 2 to ghost snare (index 3)
-        
-        int sourcePattern = rand() % 10;
-        
-        // Get the source track
-        bool tempTrack[MAX_STEPS];
-        int steps;
-        getTrackFromPattern(sourcePattern, sourceTrack, tempTrack, steps);
-        
-        // Only copy if the source pattern has the same step count
-        if (steps == variation.steps) {
-            // Don't replace main snare hits to preserve backbeat
-            if (sourceTrack == 1) {
-                // For snare track, preserve backbeat positions
-                for (int i = 0; i < variation.steps; i++) {
-                    bool isMainSnare = (i == 4 || i == 12 || i == 20 || i == 28);
-                    if (!isMainSnare) {
-                        variation.snare[i] = tempTrack[i];
-                    }
-                }
-            } else {
-                // Copy other tracks completely
-                switch (sourceTrack) {
-                    case 0: memcpy(variation.kick, tempTrack, steps * sizeof(bool)); break;
-                    case 3: memcpy(variation.ghostSnare, tempTrack, steps * sizeof(bool)); break;
-                }
+// Rotates a track's hits by one step within the pattern length
+static inline uint32_t rotateHits(uint32_t hits, int direction, int steps) {
+    const uint32_t allSteps = stepsMask(steps);
+    hits &= allSteps;
+    return direction > 0 ? ((hits << 1) | (hits >> (steps - 1))) & allSteps
+                         : ((hits >> 1) | (hits << (steps - 1))) & allSteps;
+}
+
+// Slides a track's hits one step forward or backward. Main snare hits stay
+// where they are and no hit may slide onto them; such hits keep their place.
+static uint32_t slideTrack(uint32_t hits, int track, int direction, int steps) {
+    if (track != kTrackSnare) {
+        return rotateHits(hits, direction, steps);
+    }
+    uint32_t fixed = hits & kBackbeatMask;
+    uint32_t slid = rotateHits(hits & ~kBackbeatMask, direction, steps);
+    uint32_t blocked = slid & kBackbeatMask;
+    return fixed | (slid & ~kBackbeatMask) | rotateHits(blocked, -direction, steps);
+}
+
+// Lists every mutation that would change the base pattern, so that
+// generateVariation() only has to pick one. Bounded by MAX_MUTATIONS.
+void _DnbSeqAlgorithm::buildMutations() {
+    static const int editableTracks[] = {kTrackKick, kTrackSnare, kTrackGhost}; // Never the hi-hat
+    const DrumPattern &base = dtc->basePattern;
+    const uint32_t allSteps = stepsMask(base.steps);
+    numMutations = 0;
+
+    for (int i = 0; i < 3; i++) {
+        const int track = editableTracks[i];
+        const uint32_t hits = base.hits[track] & allSteps;
+
+        // Copy the track from another pattern of the same length
+        for (int sourcePattern = 0; sourcePattern < 10; sourcePattern++) {
+            int steps;
+            uint32_t sourceHits = getTrackFromPattern(sourcePattern, track, steps);
+            if (steps != base.steps || sourceHits == 0) continue;
+            if (track == kTrackSnare) {
+                // Don't replace main snare hits to preserve backbeat
+                sourceHits = (sourceHits & ~kBackbeatMask) | (hits & kBackbeatMask);
+            }
+            if (sourceHits != hits) {
+                mutations[numMutations++] = {kMutationCopyTrack, (uint8_t) track, 0, sourceHits};
             }
         }
-    } else if (variationType == 1) {
+
         // Slide hits forward or backward one step
-        int track = rand() % 3; // 0=kick, 1=snare, 2=ghost
-        if (track >= 2) track = 3; // Map 2 to ghost snare (index 3)
-        
-        int direction = (rand() % 2) ? 1 : -1; // +1 forward, -1 backward
-        
-        bool *targetTrack = nullptr;
-        switch (track) {
-            case 0: targetTrack = variation.kick; break;
-            case 1: targetTrack = variation.snare; break;
-            case 3: targetTrack = variation.ghostSnare; break;
-        }
-        
-        if (targetTrack) {
-            bool tempTrack[MAX_STEPS];
-            memcpy(tempTrack, targetTrack, variation.steps * sizeof(bool));
-            
-            // Clear the original track
-            memset(targetTrack, 0, variation.steps * sizeof(bool));
-            
-            // Slide hits
-            for (int i = 0; i < variation.steps; i++) {
-                if (tempTrack[i]) {
-                    int newPos = (i + direction + variation.steps) % variation.steps;
-                    
-                    // Don't slide to main snare positions if this is snare track
-                    bool isMainSnareTarget = (newPos == 4 || newPos == 12 || newPos == 20 || newPos == 28) && track == 1;
-                    
-                    if (!isMainSnareTarget) {
-                        targetTrack[newPos] = true;
-                    } else {
-                        // Keep the hit in original position if we can't slide it
-                        targetTrack[i] = true;
-                    }
-                }
+        for (int direction = -1; direction <= 1; direction += 2) {
+            uint32_t slid = slideTrack(hits, track, direction, base.steps);
+            if (slid != hits) {
+                mutations[numMutations++] = {kMutationSlide, (uint8_t) track, 0, slid};
             }
         }
-    } else if (variationType == 2) {
-        // Remove a single hit (original variation)
-        int track = rand() % 3; // 0=kick, 1=snare, 2=ghost
-        if (track >= 2) track = 3; // Map 2 to ghost snare (index 3)
-        
-        // Find a position that currently has a hit
-        int attempts = 0;
-        int position;
-        bool foundHit = false;
-        
-        while (attempts < variation.steps && !foundHit) {
-            position = rand() % variation.steps;
-            
-            // Don't change main snare hits on beats 2 and 4 to keep the backbeat
-            bool isMainSnare = (position == 4 || position == 12 || position == 20 || position == 28) && track == 1;
-            
-            if (!isMainSnare) {
-                switch (track) {
-                    case 0: foundHit = variation.kick[position]; break;
-                    case 1: foundHit = variation.snare[position]; break;
-                    case 3: foundHit = variation.ghostSnare[position]; break;
-                }
-            }
-            attempts++;
+
+        // Remove a single hit, keeping the backbeat
+        uint32_t removable = track == kTrackSnare ? hits & ~kBackbeatMask : hits;
+        if (removable) {
+            mutations[numMutations++] = {kMutationRemoveHit, (uint8_t) track, 0, removable};
         }
-        
-        // Remove the hit if we found one
-        if (foundHit) {
-            switch (track) {
-                case 0: variation.kick[position] = false; break;
-                case 1: variation.snare[position] = false; break;
-                case 3: variation.ghostSnare[position] = false; break;
+
+        // Swap a step with a later track, only where the two tracks differ
+        for (int j = i + 1; j < 3; j++) {
+            const int otherTrack = editableTracks[j];
+            uint32_t swappable = (hits ^ base.hits[otherTrack]) & allSteps;
+            if (track == kTrackSnare || otherTrack == kTrackSnare) swappable &= ~kBackbeatMask;
+            if (swappable) {
+                mutations[numMutations++] = {kMutationSwapHits, (uint8_t) track,
+                                             (uint8_t) otherTrack, swappable};
             }
         }
-    } else {
-        // Swap hits between two different tracks (original variation)
-        int track1 = rand() % 3; // 0=kick, 1=snare, 2=ghost
-        int track2 = rand() % 3;
-        if (track1 >= 2) track1 = 3; // Map to ghost snare
-        if (track2 >= 2) track2 = 3; // Map to ghost snare
-        
-        // Make sure we have two different tracks
-        if (track1 != track2) {
-            int position = rand() % variation.steps;
-            
-            // Don't change main snare hits on beats 2 and 4
-            bool isMainSnare = (position == 4 || position == 12 || position == 20 || position == 28) && 
-                              (track1 == 1 || track2 == 1);
-            
-            if (!isMainSnare) {
-                bool hit1 = false, hit2 = false;
-                
-                // Get current states
-                switch (track1) {
-                    case 0: hit1 = variation.kick[position]; break;
-                    case 1: hit1 = variation.snare[position]; break;
-                    case 3: hit1 = variation.ghostSnare[position]; break;
-                }
-                switch (track2) {
-                    case 0: hit2 = variation.kick[position]; break;
-                    case 1: hit2 = variation.snare[position]; break;
-                    case 3: hit2 = variation.ghostSnare[position]; break;
-                }
-                
-                // Swap them
-                switch (track1) {
-                    case 0: variation.kick[position] = hit2; break;
-                    case 1: variation.snare[position] = hit2; break;
-                    case 3: variation.ghostSnare[position] = hit2; break;
-                }
-                switch (track2) {
-                    case 0: variation.kick[position] = hit1; break;
-                    case 1: variation.snare[position] = hit1; break;
-                    case 3: variation.ghostSnare[position] = hit1; break;
-                }
+    }
+}
+
+// Generates a random variation of the current pattern
+void _DnbSeqAlgorithm::generateVariation() {
+    DrumPattern variation = dtc->basePattern; // Start from the clean base pattern
+
+    // Choose variation type among the types that can change this pattern, then
+    // one of the mutations of that type
+    int typeCounts[kNumMutationTypes] = {0};
+    int numTypes = 0;
+    for (int i = 0; i < numMutations; i++) {
+        if (typeCounts[mutations[i].type]++ == 0) numTypes++;
+    }
+
+    if (numTypes > 0) {
+        int type = 0;
+        for (int k = dtc->rng.next() % numTypes; type < kNumMutationTypes; type++) {
+            if (typeCounts[type] > 0 && k-- == 0) break;
+        }
+        int index = 0;
+        for (int k = dtc->rng.next() % typeCounts[type]; index < numMutations; index++) {
+            if (mutations[index].type == type && k-- == 0) break;
+        }
+
+        const Mutation &m = mutations[index];
+        switch (m.type) {
+            case kMutationCopyTrack:
+            case kMutationSlide:
+                variation.hits[m.track] = m.mask;
+                break;
+            case kMutationRemoveHit:
+                variation.hits[m.track] &= ~(1u << selectHit(m.mask, dtc->rng.next() % countHits(m.mask)));
+                break;
+            case kMutationSwapHits: {
+                // The two tracks differ at every candidate step, so swapping flips both
+                uint32_t bit = 1u << selectHit(m.mask, dtc->rng.next() % countHits(m.mask));
+                variation.hits[m.track] ^= bit;
+                variation.hits[m.otherTrack] ^= bit;
+                break;
             }
         }
     }
-    
+
     dtc->currentPattern = variation;
+    buildSliceMap();
+    storeInBank(variation);
 }
 
 // Generates a variation using a specific seed and probability controls
@@ -594,67 +1794,506 @@ void _DnbSeqAlgorithm::generateVariationWithSeed(int seed) {
     DrumPattern variation = dtc->basePattern; // Start from the clean base pattern
 
     // Set seed for deterministic variations
-    srand(seed);
+    dtc->rng.seed(seed);
+    record(kEventSeed, 0, seed);
 
     // Apply multiple random changes based on probabilities
     for (int i = 0; i < 2; i++) {  // Reduced from 4 to 2 changes
         // Only modify kick, snare, or ghost snare (never hi-hat)
-        int track = rand() % 3;  // 0=kick, 1=snare, 2=ghost
-        if (track >= 2) track = 3; // Map 2 to ghost snare (index 3)
-        
-        int position = rand() % variation.steps;
+        int track = dtc->rng.next() % 3;  // 0=kick, 1=snare, 2=ghost
+        if (track >= 2) track = kTrackGhost; // Map 2 to ghost snare
+
+        int position = dtc->rng.next() % variation.steps;
 
         // Don't change main snare hits on beats 2 and 4 to keep the backbeat
-        bool isMainSnare =
-                (position == 4 || position == 12 || position == 20 || position == 28) &&
-                track == 1;
+        bool isMainSnare = ((1u << position) & kBackbeatMask) && track == kTrackSnare;
 
         if (!isMainSnare) {
             float probability = 1.0f;
-            bool shouldChange = false;
-
             switch (track) {
-                case 0: // Kick
-                    probability = dtc->bdProbability;
-                    shouldChange = (rand() / (float) RAND_MAX) < probability;
-                    if (shouldChange) {
-                        variation.kick[position] = !variation.kick[position];
-                    }
-                    break;
-                case 1: // Snare
-                    probability = dtc->snareProbability;
-                    shouldChange = (rand() / (float) RAND_MAX) < probability;
-                    if (shouldChange) {
-                        variation.snare[position] = !variation.snare[position];
-                    }
-                    break;
-                case 3: // Ghost snare
-                    probability = dtc->ghostProbability;
-                    shouldChange = (rand() / (float) RAND_MAX) < probability;
-                    if (shouldChange) {
-                        variation.ghostSnare[position] = !variation.ghostSnare[position];
+                case kTrackKick: probability = dtc->bdProbability; break;
+                case kTrackSnare: probability = dtc->snareProbability; break;
+                case kTrackGhost: probability = dtc->ghostProbability; break;
+            }
+            if ((dtc->rng.next() / (float) DnbRandom::kMax) < probability) {
+                variation.hits[track] ^= 1u << position;
+            }
+        }
+    }
+    dtc->currentPattern = variation;
+    buildSliceMap();
+    storeInBank(variation);
+}
+
+// --- Pattern Breeding ---
+
+// Cycle budget for one breeding search, and a cap on candidates scored.
+// Breeding runs on the UI thread when Breed is triggered and must leave that
+// frame to drawing: 250,000 cycles is about 0.4 ms on the 600 MHz core,
+// under 2% of a 30 Hz UI frame. bench_step prints the candidates it buys.
+const uint32_t kBreedCycleBudget = 250000;
+const int kMaxBreedCandidates = 1024;
+
+// Repeats or truncates a track so a parent of any length fits the child
+static uint32_t fitHits(uint32_t hits, int fromSteps, int toSteps) {
+    uint32_t fitted = 0;
+    for (int step = 0; step < toSteps; step++) {
+        if (hits & (1u << (step % fromSteps))) fitted |= 1u << step;
+    }
+    return fitted;
+}
+
+// Hits off the beat weigh 1 on 8th offbeats and 2 on 16ths
+static inline int syncopation(const DrumPattern &p) {
+    const uint32_t offbeat8ths = 0x44444444u;
+    const uint32_t offbeat16ths = 0xAAAAAAAAu;
+    const uint32_t hits = p.hits[kTrackKick] | p.hits[kTrackSnare] | p.hits[kTrackGhost];
+    return countHits(hits & offbeat8ths) + 2 * countHits(hits & offbeat16ths);
+}
+
+static inline int absDiff(int a, int b) {
+    return a > b ? a - b : b - a;
+}
+
+// Groove fitness, higher is better: the backbeat must survive, each track's
+// density should sit between the parents, and syncopation should be close to
+// theirs. Kick and snare on the same step, or a copy of a parent, score badly.
+static int grooveFitness(const DrumPattern &child, const DrumPattern &a, const DrumPattern &b) {
+    if (samePattern(child, a) || samePattern(child, b)) return -100000;
+
+    int score = 0;
+    const uint32_t backbeat = (a.hits[kTrackSnare] | b.hits[kTrackSnare]) & kBackbeatMask;
+    score -= 1000 * countHits(backbeat & ~child.hits[kTrackSnare]);
+    score -= 50 * countHits(child.hits[kTrackKick] & child.hits[kTrackSnare]);
+    for (int track = 0; track < kNumTracks; track++) {
+        int target = countHits(a.hits[track]) + countHits(b.hits[track]);
+        score -= 10 * absDiff(2 * countHits(child.hits[track]), target);
+    }
+    score -= 5 * absDiff(2 * syncopation(child), syncopation(a) + syncopation(b));
+    return score;
+}
+
+// Breeds two built-in patterns into a child for the current pattern length.
+// Each candidate takes every track whole from one parent or as a mix of
+// 4-step segments, then may mutate one kick or ghost step. Candidates are
+// scored until the cycle budget runs out and the fittest replaces the current
+// pattern, so the result is ready on the same UI frame. Returns the number of
+// candidates scored.
+int _DnbSeqAlgorithm::breedPatterns(int parentA, int parentB) {
+    DrumPattern a, b;
+    buildPattern(parentA, a);
+    buildPattern(parentB, b);
+
+    const int steps = dtc->basePattern.steps;
+    const uint32_t allSteps = stepsMask(steps);
+    for (int track = 0; track < kNumTracks; track++) {
+        a.hits[track] = fitHits(a.hits[track], a.steps, steps);
+        b.hits[track] = fitHits(b.hits[track], b.steps, steps);
+    }
+    a.steps = b.steps = steps;
+
+    DrumPattern best = dtc->currentPattern;
+    int bestScore = -0x7FFFFFFF;
+    const uint32_t start = NT_getCpuCycleCount();
+
+    int candidate = 0;
+    for (; candidate < kMaxBreedCandidates; candidate++) {
+        // Check the clock every few candidates; reading it isn't free
+        if ((candidate & 15) == 15 && NT_getCpuCycleCount() - start > kBreedCycleBudget) break;
+
+        DrumPattern child;
+        child.steps = steps;
+        for (int track = 0; track < kNumTracks; track++) {
+            uint32_t fromA;
+            switch (dtc->rng.next() % 3) {
+                case 0: fromA = allSteps; break;
+                case 1: fromA = 0; break;
+                default: {
+                    // Per-segment crossover, one random bit per 4 steps
+                    uint32_t segments = dtc->rng.next();
+                    fromA = 0;
+                    for (int seg = 0; seg * 4 < steps; seg++) {
+                        if (segments & (1u << seg)) fromA |= 0xFu << (seg * 4);
                     }
                     break;
+                }
             }
+            child.hits[track] = ((a.hits[track] & fromA) | (b.hits[track] & ~fromA)) & allSteps;
+        }
+
+        // Mutation: flip one kick or ghost step
+        if (dtc->rng.next() % 4 == 0) {
+            int track = (dtc->rng.next() % 2) ? kTrackKick : kTrackGhost;
+            child.hits[track] ^= 1u << (dtc->rng.next() % steps);
+        }
+
+        int score = grooveFitness(child, a, b);
+        if (score > bestScore) {
+            bestScore = score;
+            best = child;
         }
     }
-    dtc->currentPattern = variation;
+
+    dtc->currentPattern = best;
+    buildSliceMap();
+    storeInBank(best);
+    return candidate;
+}
+
+// --- Pattern Similarity ---
+
+// Per-track weights for pattern distance: kick and snare define a groove,
+// hats matter least
+static const int trackWeights[kNumTracks] = {4, 4, 1, 2, 1};
+
+// Weighted Hamming distance between two patterns of the same length
+static inline int patternDistance(const DrumPattern &a, const DrumPattern &b) {
+    const uint32_t allSteps = stepsMask(a.steps);
+    int d = 0;
+    for (int track = 0; track < kNumTracks; track++) {
+        d += trackWeights[track] * countHits((a.hits[track] ^ b.hits[track]) & allSteps);
+    }
+    return d;
+}
+
+// Remembers a generated pattern so it can be found again by similarity
+void _DnbSeqAlgorithm::storeInBank(const DrumPattern &p) {
+    library[NUM_BUILTIN_PATTERNS + bankNext] = p;
+    bankNext = (bankNext + 1) % PATTERN_BANK_SIZE;
+    if (bankCount < PATTERN_BANK_SIZE) bankCount++;
+}
+
+// Replaces the current pattern with the nearest (or farthest) library pattern
+// of the same length that differs from it. Patterns recently left or loaded
+// are skipped while any other candidate remains, so repeated turns walk on
+// through the library instead of bouncing between two patterns. A linear
+// scan of packed masks, one popcount per track; bench_step times it on a
+// 10,000-pattern bank.
+bool _DnbSeqAlgorithm::findByDistance(bool mostDifferent) {
+    const DrumPattern &current = dtc->currentPattern;
+    const int numPatterns = NUM_BUILTIN_PATTERNS + bankCount;
+    int bestIndex = -1, bestDistance = 0, bestRecent = 0;
+    int currentIndex = -1;
+
+    for (int i = 0; i < numPatterns; i++) {
+        if (library[i].steps != current.steps) continue;
+        int d = patternDistance(current, library[i]);
+        if (d == 0) {
+            currentIndex = i;
+            continue;
+        }
+        int recent = 0;
+        for (int r = 0; r < RECENT_FINDS; r++) {
+            if (recentFinds[r] == i) recent = 1;
+        }
+        if (bestIndex < 0 || recent < bestRecent ||
+            (recent == bestRecent && (mostDifferent ? d > bestDistance : d < bestDistance))) {
+            bestIndex = i;
+            bestDistance = d;
+            bestRecent = recent;
+        }
+    }
+    if (bestIndex < 0) return false;
+
+    if (currentIndex >= 0 && recentFinds[(recentNext + RECENT_FINDS - 1) % RECENT_FINDS] != currentIndex) {
+        recentFinds[recentNext] = currentIndex;
+        recentNext = (recentNext + 1) % RECENT_FINDS;
+    }
+    recentFinds[recentNext] = bestIndex;
+    recentNext = (recentNext + 1) % RECENT_FINDS;
+
+    dtc->currentPattern = library[bestIndex];
+    buildSliceMap();
+    return true;
 }
 
 // Resets the pattern to its original state
 void _DnbSeqAlgorithm::resetToDefault() {
     dtc->currentPattern = dtc->basePattern;
+    buildSliceMap();
+}
+
+// --- Break Slicer ---
+
+// Tracks a pattern plays on one step, one bit per track
+static inline uint32_t tracksAtStep(const DrumPattern &p, int step) {
+    uint32_t tracks = 0;
+    for (int track = 0; track < kNumTracks; track++) {
+        tracks |= ((p.hits[track] >> step) & 1u) << track;
+    }
+    return tracks;
+}
+
+// Picks the break slice for a step: the slice whose drums are closest to the
+// step's, weighted as in patternDistance(). Ties go to the slice nearest the
+// step's own place in the bar, so the Amen pattern plays the break straight
+// through and a variation only swaps the slices whose drums it changed.
+static int chooseSlice(const _DnbSeqAlgorithm_ITC *itc, uint32_t tracks, int step) {
+    const int home = step % kNumSlices;
+    int best = home, bestScore = 0x7FFFFFFF;
+    for (int slice = 0; slice < kNumSlices; slice++) {
+        const uint32_t differ = tracks ^ itc->sliceTracks[slice];
+        int score = 0;
+        for (int track = 0; track < kNumTracks; track++) {
+            if (differ & (1u << track)) score += trackWeights[track];
+        }
+        int away = slice > home ? slice - home : home - slice;
+        if (away > kNumSlices / 2) away = kNumSlices - away;
+        score = score * kNumSlices + away;
+        if (score < bestScore) {
+            best = slice;
+            bestScore = score;
+        }
+    }
+    return best;
+}
+
+// Maps every step of the current pattern to a slice. Called whenever the
+// pattern is loaded or changed.
+void _DnbSeqAlgorithm::buildSliceMap() {
+    for (int step = 0; step < dtc->currentPattern.steps; step++) {
+        dtc->sliceMap[step] = chooseSlice(itc, tracksAtStep(dtc->currentPattern, step), step);
+    }
+}
+
+// --- Playback Direction ---
+
+// Lays out the step order for the direction and pattern length, so step()
+// only ever moves to the next entry. The position carries over: playback goes
+// on from the step it was on, in the new order, so a change of direction
+// mid-pattern neither repeats nor skips the step under way. Called from step()
+// between blocks, and at a cycle start that changes the length.
+void _DnbSeqAlgorithm::buildStepOrder() {
+    const int steps = dtc->currentPattern.steps > 0 ? dtc->currentPattern.steps : 1;
+    const int direction = v[kParamDirection];
+    uint8_t *order = dtc->stepOrder;
+    int length = 0;
+
+    switch (direction) {
+        case kDirectionReverse:
+            for (int step = steps - 1; step >= 0; step--) order[length++] = step;
+            break;
+        case kDirectionPingPong:
+            for (int step = 0; step < steps; step++) order[length++] = step;
+            for (int step = steps - 2; step > 0; step--) order[length++] = step;
+            break;
+        case kDirectionOddEven:
+            for (int step = 0; step < steps; step += 2) order[length++] = step;
+            for (int step = 1; step < steps; step += 2) order[length++] = step;
+            break;
+        case kDirectionRandom: {
+            // Fisher-Yates, from its own generator so the shuffle depends
+            // only on the seed and the length
+            DnbRandom shuffle;
+            shuffle.seed(v[kParamShuffleSeed]);
+            for (int step = 0; step < steps; step++) order[length++] = step;
+            for (int i = steps - 1; i > 0; i--) {
+                const int j = shuffle.next() % (i + 1);
+                const uint8_t swap = order[i];
+                order[i] = order[j];
+                order[j] = swap;
+            }
+            break;
+        }
+        default:
+            for (int step = 0; step < steps; step++) order[length++] = step;
+            break;
+    }
+
+    int index = 0;
+    while (index < length && order[index] != dtc->currentStep) index++;
+    if (index == length) index = 0; // The step is gone with a shorter pattern
+
+    dtc->orderLength = length;
+    dtc->orderIndex = index;
+    dtc->currentStep = order[index];
+    dtc->orderSteps = dtc->currentPattern.steps;
+    dtc->orderDirection = direction;
+    dtc->orderSeed = v[kParamShuffleSeed];
+}
+
+// --- Bass Lane ---
+
+// A bass riff: its own rhythm, for the Riff source, and a note for each step
+// in semitones above the root, before quantising. Riffs repeat every 16 steps.
+struct BassRiff {
+    uint16_t steps; // One bit per step
+    int8_t notes[16];
+};
+
+static const BassRiff bassRiffs[] = {
+    // Root
+    {0x0441, {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}},
+    // Octaves
+    {0x5555, {0, 0, 12, 0, 0, 0, 12, 0, 0, 0, 12, 0, 0, 0, 12, 0}},
+    // Fifths
+    {0x4449, {0, 0, 0, 0, 0, 0, 7, 0, 0, 0, 0, 0, 0, 0, 7, 0}},
+    // Rolling
+    {0x4D4D, {0, 0, 0, 3, 0, 0, 5, 0, 0, 0, 3, 3, 0, 0, -2, 0}},
+    // Reese Walk
+    {0x4441, {0, 0, 0, 0, 0, 0, 3, 3, 3, 3, 5, 5, 5, 5, 7, 7}},
+};
+
+// Notes of each scale above the root, one bit per semitone
+static const uint16_t bassScales[] = {
+    0xFFF, // Chromatic
+    0x5AD, // Minor
+    0xAB5, // Major
+    0x6AD, // Dorian
+    0x5AB, // Phrygian
+    0x4A9, // Minor pentatonic
+};
+
+// Whether the bass plays a note on a step that fired these tracks
+static inline bool bassPlays(const int16_t *v, int step, uint32_t fired) {
+    if (v[kParamBassSource] == 0) return (fired >> kTrackKick) & 1;
+    return (bassRiffs[v[kParamBassRiff]].steps >> (step & 15)) & 1;
+}
+
+// The bass pitch for a step, 16.16 semitones above 0V. The riff's note is
+// moved down to the nearest note of the scale; the root is always in it.
+static int32_t bassPitch(const int16_t *v, int step) {
+    int note = bassRiffs[v[kParamBassRiff]].notes[step & 15];
+    const uint16_t scale = bassScales[v[kParamBassScale]];
+    while (!((scale >> ((note + 24) % 12)) & 1)) note--;
+    return (v[kParamBassRoot] + note + v[kParamBassOctave] * 12) << 16;
+}
+
+// Trigger probability of every track, in track order
+static inline void getProbabilities(const _DnbSeqAlgorithm_DTC *dtc, float *probabilities) {
+    probabilities[kTrackKick] = dtc->bdProbability;
+    probabilities[kTrackSnare] = dtc->snareProbability;
+    probabilities[kTrackHihat] = dtc->hihatProbability;
+    probabilities[kTrackGhost] = dtc->ghostProbability;
+    probabilities[kTrackOpenHat] = dtc->hihatProbability;
+}
+
+// Converts the probabilities to the integer thresholds rollHit() compares
+// against. Called whenever a probability changes, so step() never converts.
+void _DnbSeqAlgorithm::updateGateThresholds() {
+    float probabilities[kNumTracks];
+    getProbabilities(dtc, probabilities);
+    for (int track = 0; track < kNumTracks; track++) {
+        dtc->gateThreshold[track] = (uint32_t) (probabilities[track] * 2147483648.0f);
+    }
+}
+
+// Probability check used for every hit, whether rolled per hit or per bar: 31
+// random bits against an integer threshold, so 0% never and 100% always fires
+static inline bool rollHit(uint32_t &gateRng, uint32_t threshold) {
+    return (nextGate(gateRng) >> 1) < threshold;
+}
+
+// Rolls the probability check for every step of the pattern in one batch, so
+// triggering a step only has to test a bit
+void _DnbSeqAlgorithm::rollDice() {
+    for (int track = 0; track < kNumTracks; track++) {
+        uint32_t mask = 0;
+        // Roll every possible step so a longer pattern arriving mid-lock still plays
+        for (int step = 0; step < MAX_STEPS; step++) {
+            if (rollHit(dtc->gateRng[track], dtc->gateThreshold[track])) mask |= 1u << step;
+        }
+        dtc->diceMask[track] = mask;
+    }
+}
+
+// Works out which trig conditions pass for the current bar and fill state, and
+// turns them into per-track masks so triggering stays a single bit test
+void _DnbSeqAlgorithm::updateConditions() {
+    const int bar = dtc->barCount;
+    uint32_t passing = 1u << kCondAlways;
+    passing |= 1u << ((bar % 2 == 0) ? kCond1of2 : kCond2of2);
+    passing |= 1u << (kCond1of4 + bar % 4);
+    passing |= 1u << ((bar == 0) ? kCondFirst : kCondNotFirst);
+    passing |= 1u << (v[kParamFill] ? kCondFill : kCondNotFill);
+
+    for (int track = 0; track < kNumTracks; track++) {
+        uint32_t mask = 0;
+        for (int step = 0; step < MAX_STEPS; step++) {
+            if (passing & (1u << dtc->conditions[track][step])) mask |= 1u << step;
+        }
+        dtc->conditionMask[track] = mask;
+    }
+}
+
+// Called at the start of every pattern cycle, after any queued pattern change
+void _DnbSeqAlgorithm::beginBar() {
+    updateConditions();
+    const bool reroll = __atomic_exchange_n(&dtc->diceRerollPending, false, __ATOMIC_RELAXED);
+    if (v[kParamDiceMode] == kDicePerBar && (reroll || --dtc->diceBarsLeft <= 0)) {
+        rollDice();
+        dtc->diceBarsLeft = v[kParamDiceLock];
+    }
+}
+
+// A new pattern cycle starts at the wrap from the last step and on reset.
+// Both apply a queued pattern change, so it takes effect within one cycle.
+void _DnbSeqAlgorithm::startPatternCycle(bool fromReset) {
+    if (dtc->patternChangeQueued) {
+        generatePattern(dtc->queuedPatternId);
+        dtc->patternChangeQueued = false;
+        dtc->queuedPatternId = -1;
+        // A new length needs a new order, played from its start
+        if (dtc->currentPattern.steps != dtc->orderSteps) {
+            buildStepOrder();
+            dtc->orderIndex = 0;
+            dtc->currentStep = dtc->stepOrder[0];
+        }
+    }
+    dtc->barCount = fromReset ? 0 : dtc->barCount + 1;
+    beginBar();
+}
+
+// Empties the ring; the first snapshot is taken at the start of the next block
+void _DnbSeqAlgorithm::startRecording() {
+    recorder->writeIndex = 0;
+    recorder->numSnapshots = 0;
+    recorder->snapshotPending = true;
+}
+
+// Logs one event when the recorder is on. Reserving the slot is a single
+// atomic add, so step() and the UI can both record without a lock.
+void _DnbSeqAlgorithm::record(int type, int index, int32_t value, int sampleOffset) {
+    if (!recorder || !v[kParamRecorder]) return;
+
+    const uint32_t n = __atomic_fetch_add(&recorder->writeIndex, 1, __ATOMIC_RELAXED);
+    RecordedEvent &e = recorder->events[n & recorder->eventMask];
+    __atomic_store_n(&e.seq, 0, __ATOMIC_RELAXED);
+    e.sample = dtc->sampleCount + sampleOffset;
+    e.type = type;
+    e.index = index;
+    e.value = value;
+    __atomic_store_n(&e.seq, n + 1, __ATOMIC_RELEASE);
+}
+
+// Called from step() between blocks, when the state is consistent
+void _DnbSeqAlgorithm::takeSnapshot() {
+    RecorderSnapshot &snapshot = recorder->snapshots[recorder->numSnapshots & 1];
+    snapshot.eventIndex = recorder->writeIndex;
+    memcpy(snapshot.v, v, sizeof(snapshot.v));
+    snapshot.dtc = *dtc;
+    memcpy(snapshot.bank, &library[NUM_BUILTIN_PATTERNS], sizeof(snapshot.bank));
+    snapshot.bankCount = bankCount;
+    snapshot.bankNext = bankNext;
+    recorder->numSnapshots++;
+    recorder->snapshotPending = false;
 }
 
 // --- Plugin API Functions ---
 
+// Samples per 24 PPQN pulse at a tempo in tenths of a BPM, 16.16
+static uint32_t tempoPeriod(int tempoTenths) {
+    return (uint32_t) ((uint64_t) NT_globals.sampleRate * 600 * 65536 / ((uint64_t) tempoTenths * 24));
+}
+
 void calculateRequirements(_NT_algorithmRequirements &req,
                            const int32_t *specifications) {
     req.numParameters = ARRAY_SIZE(parameters);
-    req.sram = sizeof(_DnbSeqAlgorithm);
-    req.dram = 0;
+    req.sram = sizeof(_DnbSeqAlgorithm) + 2 * NT_globals.maxFramesPerStep * sizeof(float);
+    const uint32_t events = recorderEvents(specifications);
+    req.dram = events ? sizeof(EventRecorder) + events * sizeof(RecordedEvent) : 0;
     req.dtc = sizeof(_DnbSeqAlgorithm_DTC);
-    req.itc = 0;
+    req.itc = sizeof(_DnbSeqAlgorithm_ITC);
 }
 
 _NT_algorithm *construct(const _NT_algorithmMemoryPtrs &ptrs,
@@ -662,12 +2301,42 @@ _NT_algorithm *construct(const _NT_algorithmMemoryPtrs &ptrs,
                          const int32_t *specifications) {
     // Use placement new to construct the algorithm in the pre-allocated SRAM
     _DnbSeqAlgorithm *alg =
-            new(ptrs.sram) _DnbSeqAlgorithm((_DnbSeqAlgorithm_DTC *) ptrs.dtc);
+            new(ptrs.sram) _DnbSeqAlgorithm((_DnbSeqAlgorithm_DTC *) ptrs.dtc,
+                                            (_DnbSeqAlgorithm_ITC *) ptrs.itc);
     alg->parameters = parameters;
     alg->parameterPages = &parameterPages;
+    alg->recorder = nullptr;
+    alg->exportRecording = false;
+    if (const uint32_t events = recorderEvents(specifications)) {
+        alg->recorder = (EventRecorder *) ptrs.dram;
+        alg->recorder->events = (RecordedEvent *) (ptrs.dram + sizeof(EventRecorder));
+        alg->recorder->eventMask = events - 1;
+    }
+    alg->pulseClockFrames = (float *) (ptrs.sram + sizeof(_DnbSeqAlgorithm));
+    alg->pulseResetFrames = alg->pulseClockFrames + NT_globals.maxFramesPerStep;
+    alg->dtc->densityThreshold = -1; // No masks until the first update
+    alg->dtc->sampleCount = 0;
+    alg->dtc->densityCv = 0;
+    alg->dtc->blockCycles = 0;
+    alg->dtc->peakBlockCycles = 0;
+    alg->dtc->midi.head = 0;
+    alg->dtc->midi.tail = 0;
+    alg->dtc->lastBlockCycles = NT_getCpuCycleCount();
+    alg->dtc->midiRunning = true;
+    alg->dtc->midiOut.head = 0;
+    alg->dtc->midiOut.tail = 0;
+    alg->dtc->midiNotesOn = 0;
+    alg->dtc->numSyncEdges = 0;
+    alg->dtc->internalPeriod = tempoPeriod(parameters[kParamTempo].def * 10);
+    alg->dtc->internalPhase = 0;
+    alg->dtc->cyclesPerSample = 0.0f; // Measured from the second block on
+    alg->numTaps = 0;
+    alg->tapTempo = 0;
+    alg->tempoTenths = parameters[kParamTempo].def * 10;
+    if (alg->recorder) alg->startRecording();
 
     // Initialize state
-    srand(NT_getCpuCycleCount()); // Seed RNG
+    alg->seedRandom(NT_getCpuCycleCount());
     alg->dtc->currentStep = 0;
     alg->dtc->pulseCount = 0;
     alg->dtc->pulsesPerStep = 6;
@@ -678,17 +2347,43 @@ _NT_algorithm *construct(const _NT_algorithmMemoryPtrs &ptrs,
     alg->dtc->queuedPatternId = -1;
     alg->dtc->patternChangeQueued = false;
 
-    // Initialize trigger counters
-    alg->dtc->kickTriggerSamples = 0;
-    alg->dtc->snareTriggerSamples = 0;
-    alg->dtc->hihatTriggerSamples = 0;
-    alg->dtc->ghostTriggerSamples = 0;
+    // Initialize output gates and the clock measurement
+    alg->clearTriggers();
+    alg->dtc->lastClockSample = 0;
+    alg->dtc->clockPeriod = 0;
+    alg->dtc->lastFireSample = 0;
+    alg->dtc->lastFireIndex = 0;
+    memset(alg->dtc->captureHigh, 0, sizeof(alg->dtc->captureHigh));
 
     // Initialize custom UI state
     alg->dtc->currentSeed = 0;
     alg->dtc->bdProbability = 1.0f;
     alg->dtc->snareProbability = 1.0f;
     alg->dtc->ghostProbability = 1.0f;
+    alg->dtc->hihatProbability = alg->v[kParamHihatProbability] / 100.0f;
+    alg->updateGateThresholds();
+    alg->dtc->diceBarsLeft = 0;
+    alg->dtc->diceRerollPending = false;
+
+    // Every step starts unconditional
+    memset(alg->dtc->conditions, kCondAlways, sizeof(alg->dtc->conditions));
+    alg->dtc->barCount = 0;
+
+    // Pack the built-in patterns into the ITC table; the break slicer's slices
+    // play what the Amen pattern plays on each step
+    for (int i = 0; i < NUM_BUILTIN_PATTERNS; i++) {
+        buildPattern(i, alg->itc->builtinPatterns[i]);
+    }
+    for (int slice = 0; slice < kNumSlices; slice++) {
+        alg->itc->sliceTracks[slice] = tracksAtStep(alg->itc->builtinPatterns[kAmenPatternId], slice);
+    }
+    alg->dtc->slice = 0;
+    alg->dtc->sliceTrigSamples = 0;
+    alg->dtc->bass.pitch = 0;
+    alg->dtc->bass.target = 0;
+    alg->dtc->bass.rate = 0;
+    alg->dtc->duck.level = 0.0f;
+    alg->dtc->duck.stage = kDuckIdle;
 
     // Generate initial pattern based on parameter value (with safety check)
     int patternId = alg->v[kParamPatternSelect];
@@ -697,6 +2392,22 @@ _NT_algorithm *construct(const _NT_algorithmMemoryPtrs &ptrs,
         patternId = 0; // Default to Two-Step if invalid
     }
     alg->generatePattern(patternId);
+    alg->buildStepOrder();
+
+    // Seed the similarity library with the built-in patterns
+    for (int i = 0; i < NUM_BUILTIN_PATTERNS; i++) {
+        alg->library[i] = alg->itc->builtinPatterns[i];
+    }
+    alg->bankCount = 0;
+    alg->bankNext = 0;
+    for (int r = 0; r < RECENT_FINDS; r++) alg->recentFinds[r] = -1;
+    alg->recentNext = 0;
+    alg->updateDensity(alg->v[kParamDensity] * kMaxDensityThreshold / 100);
+    // Roll dice whatever the mode, so switching to Per Bar mid-bar plays real
+    // rolls until the next bar rolls fresh ones
+    alg->rollDice();
+    alg->beginBar();
+    alg->selectStepVariant();
 
     return alg;
 }
@@ -704,6 +2415,8 @@ _NT_algorithm *construct(const _NT_algorithmMemoryPtrs &ptrs,
 void parameterChanged(_NT_algorithm *self, int p) {
     _DnbSeqAlgorithm *pThis = (_DnbSeqAlgorithm *) self;
 
+    pThis->record(kEventParameter, p, pThis->v[p]);
+
     if (p == kParamPatternSelect) {
         // Queue the pattern change instead of applying immediately
         pThis->dtc->queuedPatternId = pThis->v[kParamPatternSelect];
@@ -722,7 +2435,95 @@ void parameterChanged(_NT_algorithm *self, int p) {
             NT_setParameterFromUi(NT_algorithmIndex(self),
                                   kParamResetToDefault + NT_parameterOffset(), 0);
         }
+    } else if (p == kParamBreed) {
+        if (pThis->v[kParamBreed] == 1) {
+            pThis->breedPatterns(pThis->v[kParamBreedParentA], pThis->v[kParamBreedParentB]);
+            // Reset trigger parameter
+            NT_setParameterFromUi(NT_algorithmIndex(self),
+                                  kParamBreed + NT_parameterOffset(), 0);
+        }
+    } else if (p == kParamDiceMode || p == kParamDiceLock) {
+        // Roll fresh dice for the new setting at the next bar. step() owns the
+        // dice and their random streams, so they aren't rolled from here.
+        __atomic_store_n(&pThis->dtc->diceRerollPending, true, __ATOMIC_RELAXED);
+    } else if (p == kParamCondTrack || p == kParamCondStep) {
+        // Show the condition stored for the newly selected step
+        int track = pThis->v[kParamCondTrack];
+        int step = pThis->v[kParamCondStep] - 1;
+        NT_setParameterFromUi(NT_algorithmIndex(self), kParamCondition + NT_parameterOffset(),
+                              pThis->dtc->conditions[track][step]);
+    } else if (p == kParamCondition) {
+        int track = pThis->v[kParamCondTrack];
+        int step = pThis->v[kParamCondStep] - 1;
+        pThis->dtc->conditions[track][step] = pThis->v[kParamCondition];
+        pThis->updateConditions();
+    } else if (p == kParamFill) {
+        pThis->updateConditions();
+    } else if (p == kParamHihatProbability) {
+        pThis->dtc->hihatProbability = pThis->v[kParamHihatProbability] / 100.0f;
+        pThis->updateGateThresholds();
+    } else if (p == kParamRecorder) {
+        if (pThis->recorder && pThis->v[kParamRecorder]) pThis->startRecording();
+    } else if (p == kParamExportRecording) {
+        if (pThis->v[kParamExportRecording] == 1) {
+            pThis->exportRecording = true;
+            // Reset trigger parameter
+            NT_setParameterFromUi(NT_algorithmIndex(self),
+                                  kParamExportRecording + NT_parameterOffset(), 0);
+        }
+    } else if (p == kParamCpuMeter) {
+        pThis->dtc->peakBlockCycles = 0;
+    } else if (p == kParamTempo) {
+        // A tapped tempo keeps the period it was measured at; the parameter
+        // only holds it rounded
+        if (pThis->v[kParamTempo] != pThis->tapTempo) {
+            pThis->tempoTenths = pThis->v[kParamTempo] * 10;
+            pThis->publishTempo(tempoPeriod(pThis->tempoTenths));
+        }
+        pThis->tapTempo = 0;
+    }
+
+    if (p == kParamResetInput || p == kParamOpenHatOutput || p == kParamRecorder ||
+        p == kParamClockSource || p == kParamSyncMode || (p >= kParamKickOffset && p <= kParamOpenHatOffset)) {
+        pThis->selectStepVariant();
+    }
+    // Follow a MIDI clock that is already running, until it sends Stop
+    if (p == kParamClockSource) pThis->dtc->midiRunning = true;
+}
+
+// --- Sequencer Position ---
+
+// What a clock or reset edge calls for, as flags for step() to act on
+enum {
+    kEdgeFireStep = 1 << 0, // Triggers are due for the step the edge arrived on
+    kEdgeCycleStart = 1 << 1, // A pattern cycle starts; see startPatternCycle()
+};
+
+// Moves the position on by one clock pulse. Triggers fire on the first pulse
+// of a step and the step advances on the last, to the next entry of the step
+// order, wrapping without a divide; an index that is somehow out of range
+// wraps too. Free of side effects, so the host verifier can check it
+// exhaustively.
+static inline int clockEdge(int &currentStep, int &orderIndex, int &pulseCount, int pulsesPerStep,
+                            const uint8_t *order, int orderLength) {
+    int edge = 0;
+    if (++pulseCount == 1) edge |= kEdgeFireStep;
+    if (pulseCount >= pulsesPerStep) {
+        pulseCount = 0;
+        orderIndex = orderIndex + 1 < orderLength ? orderIndex + 1 : 0;
+        currentStep = order[orderIndex];
+        if (orderIndex == 0) edge |= kEdgeCycleStart;
     }
+    return edge;
+}
+
+// A reset returns to the first pulse of the first step in the order and
+// starts a new cycle
+static inline int resetEdge(int &currentStep, int &orderIndex, int &pulseCount, const uint8_t *order) {
+    orderIndex = 0;
+    currentStep = order[0];
+    pulseCount = 0;
+    return kEdgeCycleStart;
 }
 
 // Helper to detect rising edge
@@ -733,116 +2534,898 @@ static inline bool isRisingEdge(float sample, bool &state) {
     return rising;
 }
 
-void step(_NT_algorithm *self, float *busFrames, int numFramesBy4) {
-    _DnbSeqAlgorithm *pThis = (_DnbSeqAlgorithm *) self;
+// --- Output Gates ---
+
+// Queues a gate on one output. A full queue drops the gate rather than
+// block; a gate earlier than the last one queued (the offset was just turned
+// down) waits for it, to keep the queue in time order.
+static inline void queueTrigger(TriggerQueue &q, uint32_t time, int length) {
+    if (q.tail - q.head == (uint32_t) kTriggerQueueSize) return;
+    if (q.tail != q.head) {
+        const uint32_t last = q.events[(q.tail - 1) & (kTriggerQueueSize - 1)].time;
+        if ((int32_t) (time - last) < 0) time = last;
+    }
+    TriggerEvent &e = q.events[q.tail & (kTriggerQueueSize - 1)];
+    e.time = time;
+    e.length = length;
+    q.tail++;
+}
+
+// Takes back the gates queued after `time`, newest first
+static inline void unqueueAfter(TriggerQueue &q, uint32_t time) {
+    while (q.tail != q.head && (int32_t) (q.events[(q.tail - 1) & (kTriggerQueueSize - 1)].time - time) > 0) {
+        q.tail--;
+    }
+}
+
+// Writes one block of an output as spans between its queued gates, so the
+// work is one fill per span and one step per gate. With no output bus the
+// gate still runs, so it is in step when the output is routed again.
+static inline void renderGate(float *out, int numFrames, uint32_t blockStart, int &gateSamples, TriggerQueue &q) {
+    int i = 0;
+    while (i < numFrames) {
+        int end = numFrames;
+        bool starts = false;
+        if (q.head != q.tail) {
+            // A gate that is already late starts straight away
+            const int32_t at = (int32_t) (q.events[q.head & (kTriggerQueueSize - 1)].time - blockStart);
+            if (at < numFrames) {
+                end = at > i ? at : i;
+                starts = true;
+            }
+        }
+        const int high = gateSamples < end - i ? gateSamples : end - i;
+        if (out) {
+            for (int k = i; k < i + high; k++) out[k] = 5.0f;
+            for (int k = i + high; k < end; k++) out[k] = 0.0f;
+        }
+        gateSamples -= high;
+        i = end;
+        if (starts) {
+            gateSamples = q.events[q.head & (kTriggerQueueSize - 1)].length;
+            q.head++;
+        }
+    }
+}
+
+// Writes one block of the slice CV as spans between its queued changes, at
+// 1/12V (a semitone) per slice
+static inline void renderSlices(float *out, int numFrames, uint32_t blockStart, int &slice, TriggerQueue &q) {
+    int i = 0;
+    while (i < numFrames) {
+        int end = numFrames;
+        bool changes = false;
+        if (q.head != q.tail) {
+            const int32_t at = (int32_t) (q.events[q.head & (kTriggerQueueSize - 1)].time - blockStart);
+            if (at < numFrames) {
+                end = at > i ? at : i;
+                changes = true;
+            }
+        }
+        if (out) {
+            const float volts = slice / 12.0f;
+            for (int k = i; k < end; k++) out[k] = volts;
+        }
+        i = end;
+        if (changes) {
+            slice = q.events[q.head & (kTriggerQueueSize - 1)].length;
+            q.head++;
+        }
+    }
+}
+
+// Writes one block of the bass pitch between its queued notes. Each note sets
+// a new glide, worked out once; between notes only the glide runs, and a
+// held note is a plain fill.
+static inline void renderBass(float *out, int numFrames, uint32_t blockStart, BassLane &bass, int glideSamples) {
+    const float voltsPerUnit = 1.0f / (12 * 65536);
+    int i = 0;
+    while (i < numFrames) {
+        int end = numFrames;
+        bool changes = false;
+        if (bass.notes.head != bass.notes.tail) {
+            const int32_t at = (int32_t) (bass.notes.events[bass.notes.head & (kTriggerQueueSize - 1)].time - blockStart);
+            if (at < numFrames) {
+                end = at > i ? at : i;
+                changes = true;
+            }
+        }
+        for (; i < end && bass.pitch != bass.target; i++) {
+            bass.pitch += bass.rate;
+            if ((bass.rate > 0) == (bass.pitch > bass.target)) bass.pitch = bass.target;
+            if (out) out[i] = bass.pitch * voltsPerUnit;
+        }
+        if (out) {
+            const float volts = bass.pitch * voltsPerUnit;
+            for (int k = i; k < end; k++) out[k] = volts;
+        }
+        i = end;
+        if (changes) {
+            bass.target = bass.notes.events[bass.notes.head & (kTriggerQueueSize - 1)].length;
+            bass.notes.head++;
+            if (glideSamples > 0) {
+                bass.rate = (bass.target - bass.pitch) / glideSamples;
+                if (bass.rate == 0) bass.rate = bass.target > bass.pitch ? 1 : -1;
+            } else {
+                bass.pitch = bass.target;
+            }
+        }
+    }
+}
+
+// Writes one block of the sidechain duck CV: 5V at rest, pulled down by the
+// envelope times the depth. Each kick restarts the attack from wherever the
+// envelope is; once released the output is a plain fill until the next kick.
+// With no output bus the kicks are dropped and the envelope rests.
+static inline void renderDuck(float *out, int numFrames, uint32_t blockStart, DuckEnvelope &duck,
+                              float attackStep, float releaseStep, float depthVolts) {
+    if (!out) {
+        while (duck.hits.head != duck.hits.tail &&
+               (int32_t) (duck.hits.events[duck.hits.head & (kTriggerQueueSize - 1)].time - blockStart) < numFrames) {
+            duck.hits.head++;
+        }
+        duck.level = 0.0f;
+        duck.stage = kDuckIdle;
+        return;
+    }
+    int i = 0;
+    while (i < numFrames) {
+        int end = numFrames;
+        bool starts = false;
+        if (duck.hits.head != duck.hits.tail) {
+            const int32_t at = (int32_t) (duck.hits.events[duck.hits.head & (kTriggerQueueSize - 1)].time - blockStart);
+            if (at < numFrames) {
+                end = at > i ? at : i;
+                starts = true;
+            }
+        }
+        for (; i < end && duck.stage == kDuckAttack; i++) {
+            duck.level += attackStep;
+            if (duck.level >= 1.0f) {
+                duck.level = 1.0f;
+                duck.stage = kDuckRelease;
+            }
+            out[i] = 5.0f - duck.level * depthVolts;
+        }
+        for (; i < end && duck.stage == kDuckRelease; i++) {
+            duck.level -= releaseStep;
+            if (duck.level <= 0.0f) {
+                duck.level = 0.0f;
+                duck.stage = kDuckIdle;
+            }
+            out[i] = 5.0f - duck.level * depthVolts;
+        }
+        for (int k = i; k < end; k++) out[k] = 5.0f;
+        i = end;
+        if (starts) {
+            duck.hits.head++;
+            duck.stage = kDuckAttack;
+        }
+    }
+}
+
+// Works out which tracks fire on a step, one bit per track, applying density,
+// trig conditions and probability controls as track muting
+static inline uint32_t stepTracks(_DnbSeqAlgorithm *pThis, int step) {
+    _DnbSeqAlgorithm_DTC *dtc = pThis->dtc;
+    const uint32_t stepBit = 1u << step;
+    // With per-bar dice the checks were rolled at the bar boundary
+    const bool perBar = pThis->v[kParamDiceMode] == kDicePerBar;
+
+    // With neither Open Hat Out nor its MIDI channel set, open hats play on
+    // the hi-hat output, so the grooves sound as they did before the lane.
+    // They only fill steps the hi-hat lane has no hit on, and the hi-hat's
+    // condition and probability decide the step once.
+    const bool openHatRouted = pThis->v[kParamOpenHatOutput] > 0 || pThis->v[kParamOpenHatMidiChannel] > 0;
+
+    uint32_t fired = 0;
+    for (int track = 0; track < kNumTracks; track++) {
+        uint32_t hits = densityHits(dtc, track);
+        if (!openHatRouted) {
+            if (track == kTrackOpenHat) continue;
+            if (track == kTrackHihat) {
+                hits |= densityHits(dtc, kTrackOpenHat) & ~dtc->currentPattern.hits[kTrackHihat];
+            }
+        }
+        if (hits & dtc->conditionMask[track] & stepBit) {
+            if (perBar ? (dtc->diceMask[track] & stepBit)
+                       : rollHit(dtc->gateRng[track], dtc->gateThreshold[track])) {
+                fired |= 1u << track;
+            }
+        }
+    }
+
+    // Hat choke group: an open hat replaces the closed hat on its own step,
+    // and a closed hat that fires cuts off a ringing open hat
+    fired &= ~(((fired >> kTrackOpenHat) & 1u) << kTrackHihat);
+    return fired;
+}
+
+// Queues the gates for one step on one output. Every step restarts or cuts
+// the kick, snare, hat and ghost gates; the open hat only starts on its own
+// hits and is cut by the closed hat. The sidechain duck follows the kick gate,
+// offset and all.
+static inline void queueStep(_DnbSeqAlgorithm_DTC *dtc, int track, uint32_t time, uint32_t fired,
+                             int gateLengthSamples, int openHatGateSamples) {
+    if (track != kTrackOpenHat) {
+        queueTrigger(dtc->triggers[track], time, (fired & (1u << track)) ? gateLengthSamples : 0);
+        if (track == kTrackKick && (fired & (1u << kTrackKick))) queueTrigger(dtc->duck.hits, time, 0);
+    } else if (fired & (1u << kTrackOpenHat)) {
+        queueTrigger(dtc->triggers[track], time, openHatGateSamples);
+    } else if (fired & (1u << kTrackHihat)) {
+        queueTrigger(dtc->triggers[track], time, 0);
+    }
+}
+
+// --- MIDI Note Output ---
+
+// Adds a message to the outgoing queue; if it is full the message is dropped
+static inline void queueMidi(MidiOutQueue &q, uint8_t status, uint8_t data1, uint8_t data2) {
+    const uint32_t tail = q.tail;
+    if (tail - __atomic_load_n(&q.head, __ATOMIC_ACQUIRE) == (uint32_t) kMidiOutQueueSize) return;
+    q.messages[tail & (kMidiOutQueueSize - 1)] = {status, data1, data2};
+    __atomic_store_n(&q.tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+// Velocity of a track's note on a step
+static inline uint8_t midiVelocity(_DnbSeqAlgorithm *pThis, int track, int step) {
+    switch (pThis->v[kParamMidiVelocity]) {
+        case kVelocityProbability:
+            return (uint8_t) (1 + (((uint64_t) pThis->dtc->gateThreshold[track] * 126) >> 31));
+        case kVelocityAccent: {
+            if (track == kTrackGhost) return 64;
+            const int stepsPerBeat = (pThis->dtc->currentPattern.steps == 24) ? 6 : 4; // Triplet patterns
+            return step % stepsPerBeat == 0 ? 127 : 96;
+        }
+        default:
+            return 100;
+    }
+}
+
+// Queues the note offs of the given tracks' sounding notes
+static void endMidiNotes(_DnbSeqAlgorithm_DTC *dtc, uint32_t tracks) {
+    tracks &= dtc->midiNotesOn;
+    for (int track = 0; track < kNumTracks; track++) {
+        if (tracks & (1u << track)) {
+            const MidiMessage &off = dtc->midiNoteOff[track];
+            queueMidi(dtc->midiOut, off.status, off.data1, 0);
+        }
+    }
+    dtc->midiNotesOn &= ~tracks;
+}
+
+// Ends the notes whose length has run out by the end of the block. This runs
+// every block, so notes end on time when the clock stops or changes source.
+static void endExpiredMidiNotes(_DnbSeqAlgorithm_DTC *dtc) {
+    uint32_t expired = 0;
+    for (int track = 0; track < kNumTracks; track++) {
+        if ((dtc->midiNotesOn & (1u << track)) && (int32_t) (dtc->sampleCount - dtc->midiNoteEnd[track]) >= 0) {
+            expired |= 1u << track;
+        }
+    }
+    endMidiNotes(dtc, expired);
+}
+
+// Queues the MIDI notes for a step. Each note lasts as long as its gate; a
+// track that fires again ends its note first, and a closed hat ends the
+// open hat's, as the choke does on the gates.
+static void queueMidiNotes(_DnbSeqAlgorithm *pThis, int step, uint32_t fired, uint32_t now,
+                           int gateLengthSamples, int openHatGateSamples) {
+    _DnbSeqAlgorithm_DTC *dtc = pThis->dtc;
+    endMidiNotes(dtc, fired | ((fired >> kTrackHihat) & 1u) << kTrackOpenHat);
+    for (int track = 0; track < kNumTracks; track++) {
+        const int channel = pThis->v[kParamKickMidiChannel + 2 * track];
+        if (channel == 0 || !(fired & (1u << track))) continue;
+        const uint8_t note = (uint8_t) pThis->v[kParamKickMidiNote + 2 * track];
+        queueMidi(dtc->midiOut, 0x90 | (channel - 1), note, midiVelocity(pThis, track, step));
+        dtc->midiNoteOff[track] = {(uint8_t) (0x80 | (channel - 1)), note, 0};
+        dtc->midiNoteEnd[track] = now + (track == kTrackOpenHat ? openHatGateSamples : gateLengthSamples);
+        dtc->midiNotesOn |= 1u << track;
+    }
+}
+
+// Sends what the block queued
+static void flushMidiNotes(_DnbSeqAlgorithm *pThis) {
+    MidiOutQueue &q = pThis->dtc->midiOut;
+    const uint32_t destination = midiDestinations[pThis->v[kParamMidiDestination]];
+    const uint32_t tail = __atomic_load_n(&q.tail, __ATOMIC_ACQUIRE);
+    uint32_t head = q.head;
+    for (; head != tail; head++) {
+        const MidiMessage &m = q.messages[head & (kMidiOutQueueSize - 1)];
+        NT_sendMidi3ByteMessage(destination, m.status, m.data1, m.data2);
+    }
+    __atomic_store_n(&q.head, head, __ATOMIC_RELEASE);
+}
+
+// --- Live Capture ---
+
+// Adds hits from the capture inputs to the current pattern. Each rising edge
+// is placed on the nearest step, measured from the last step that fired in
+// whole steps of the measured clock period. Runs before the block is played,
+// and sets each hit with an atomic OR, so playback never waits on it and a
+// pattern written by the UI at the same time keeps the hit or loses it whole.
+static void captureHits(_DnbSeqAlgorithm *pThis, float *busFrames, int numFrames) {
+    _DnbSeqAlgorithm_DTC *dtc = pThis->dtc;
+    const int32_t stepSamples = (int32_t) (dtc->clockPeriod * dtc->pulsesPerStep);
+
+    for (int track = 0; track < kNumTracks; track++) {
+        const int bus = pThis->v[kParamKickCaptureInput + track];
+        if (bus <= 0) continue;
+        const float *in = busFrames + (bus - 1) * numFrames;
+        for (int i = 0; i < numFrames; i++) {
+            if (!isRisingEdge(in[i], dtc->captureHigh[track])) continue;
+
+            const int32_t sinceFire = (int32_t) (dtc->sampleCount + i - dtc->lastFireSample);
+            const int stepsOn = stepSamples > 0 && sinceFire > 0 ? (sinceFire + stepSamples / 2) / stepSamples : 0;
+            const int step = dtc->stepOrder[(dtc->lastFireIndex + stepsOn) % dtc->orderLength];
+
+            __atomic_fetch_or(&dtc->currentPattern.hits[track], 1u << step, __ATOMIC_RELAXED);
+            dtc->sliceMap[step] = chooseSlice(pThis->itc, tracksAtStep(dtc->currentPattern, step), step);
+            pThis->record(kEventCapture, track, step);
+        }
+    }
+}
+
+// Optional parts of the step() loop that cost something on every sample or
+// every edge. Each variant is compiled with only the parts its feature bits
+// name, so a block doesn't pay for inputs, outputs or logging that aren't in
+// use. A part that is compiled in still checks its parameter, so the variant
+// with every bit set is the general loop and is correct for any setting.
+// Settings that are only read once per block or per step stay as branches;
+// each variant adds about 1KB of code.
+enum {
+    kStepReset = 1 << 0, // Reset input routed
+    kStepOpenHat = 1 << 1, // Open hat output routed
+    kStepRecorder = 1 << 2, // Event recorder on
+    kStepLookahead = 1 << 3, // An output is set to fire early
+    kNumStepVariants = 1 << 4,
+    kStepAllFeatures = kNumStepVariants - 1,
+};
+
+// Latency compensation: each output's gates are queued at the step's time
+// plus its offset. Delayed outputs simply hold their gates in the queue. For
+// outputs that fire early, the next step is decided ahead of its clock edge,
+// at the edge predicted from the measured clock period less the largest
+// advance, and the early gates are queued then; the edge itself plays the
+// same decision on the other outputs. Steps are decided no earlier than the
+// edge before, so an advance longer than one clock pulse is cut short.
+template <int Features>
+static void stepVariant(_DnbSeqAlgorithm *pThis, float *busFrames, int numFrames) {
     _DnbSeqAlgorithm_DTC *dtc = pThis->dtc;
-    int numFrames = numFramesBy4 * 4;
 
-    // Get input and output busses
-    float *clockIn = busFrames + (pThis->v[kParamClockInput] - 1) * numFrames;
+    // Keep a recorder snapshot no more than half a ring behind the events
+    if ((Features & kStepRecorder) && pThis->v[kParamRecorder] &&
+        (pThis->recorder->snapshotPending ||
+         pThis->recorder->writeIndex - pThis->recorder->snapshots[(pThis->recorder->numSnapshots - 1) & 1].eventIndex >=
+         (pThis->recorder->eventMask + 1) / 2)) {
+        pThis->takeSnapshot();
+    }
+
+    // Get input and output busses. The internal clock makes clock pulses but
+    // leaves the reset to Reset In.
+    const bool follower = pThis->v[kParamSyncMode] == kSyncFollower;
+    const bool madeClock = follower || pThis->v[kParamClockSource] != kClockCv;
+    const bool madeReset = follower || pThis->v[kParamClockSource] == kClockMidi;
+    const bool leader = pThis->v[kParamSyncMode] == kSyncLeader;
+    float *clockIn = madeClock ? pThis->pulseClockFrames : busFrames + (pThis->v[kParamClockInput] - 1) * numFrames;
     float *resetIn =
-            pThis->v[kParamResetInput] > 0
-                ? busFrames + (pThis->v[kParamResetInput] - 1) * numFrames
+            !(Features & kStepReset) ? nullptr
+            : madeReset ? pThis->pulseResetFrames
+            : pThis->v[kParamResetInput] > 0 ? busFrames + (pThis->v[kParamResetInput] - 1) * numFrames
+            : nullptr;
+    float *densityIn =
+            pThis->v[kParamDensityInput] > 0
+                ? busFrames + (pThis->v[kParamDensityInput] - 1) * numFrames
                 : nullptr;
 
-    float *kickOut = busFrames + (pThis->v[kParamKickOutput] - 1) * numFrames;
-    float *snareOut = busFrames + (pThis->v[kParamSnareOutput] - 1) * numFrames;
-    float *hihatOut = busFrames + (pThis->v[kParamHihatOutput] - 1) * numFrames;
-    float *ghostSnareOut =
-            busFrames + (pThis->v[kParamGhostSnareOutput] - 1) * numFrames;
+    // Outputs in track order; the open hat is optional
+    float *outputs[kNumTracks] = {
+        busFrames + (pThis->v[kParamKickOutput] - 1) * numFrames,
+        busFrames + (pThis->v[kParamSnareOutput] - 1) * numFrames,
+        busFrames + (pThis->v[kParamHihatOutput] - 1) * numFrames,
+        busFrames + (pThis->v[kParamGhostSnareOutput] - 1) * numFrames,
+        (Features & kStepOpenHat) && pThis->v[kParamOpenHatOutput] > 0
+            ? busFrames + (pThis->v[kParamOpenHatOutput] - 1) * numFrames
+            : nullptr,
+    };
+    const int numOutputs = (Features & kStepOpenHat) ? kNumTracks : kTrackOpenHat;
+    float *sliceCvOut =
+            pThis->v[kParamSliceCvOutput] > 0
+                ? busFrames + (pThis->v[kParamSliceCvOutput] - 1) * numFrames
+                : nullptr;
+    float *sliceTrigOut =
+            pThis->v[kParamSliceTrigOutput] > 0
+                ? busFrames + (pThis->v[kParamSliceTrigOutput] - 1) * numFrames
+                : nullptr;
+    float *bassPitchOut =
+            pThis->v[kParamBassPitchOutput] > 0
+                ? busFrames + (pThis->v[kParamBassPitchOutput] - 1) * numFrames
+                : nullptr;
+    float *bassGateOut =
+            pThis->v[kParamBassGateOutput] > 0
+                ? busFrames + (pThis->v[kParamBassGateOutput] - 1) * numFrames
+                : nullptr;
+    float *duckOut =
+            pThis->v[kParamDuckOutput] > 0
+                ? busFrames + (pThis->v[kParamDuckOutput] - 1) * numFrames
+                : nullptr;
 
     // Fixed 10ms gate length
     const int gateLengthSamples =
             (int) ((10.0f / 1000.0f) * NT_globals.sampleRate);
+    const int openHatGateSamples =
+            (int) ((pThis->v[kParamOpenHatGate] / 1000.0f) * NT_globals.sampleRate);
+    const int bassGateSamples =
+            (int) ((pThis->v[kParamBassGate] / 1000.0f) * NT_globals.sampleRate);
+    const int bassGlideSamples =
+            (int) ((pThis->v[kParamBassGlide] / 1000.0f) * NT_globals.sampleRate);
+    bool midiNotes = dtc->midiNotesOn != 0; // Notes still to end
+    for (int track = 0; track < kNumTracks; track++) {
+        if (pThis->v[kParamKickMidiChannel + 2 * track]) midiNotes = true;
+    }
 
-    // Per-sample processing
+    // Output offsets in samples, and the largest advance among them
+    int offsets[kNumTracks];
+    int advance = 0;
+    for (int track = 0; track < numOutputs; track++) {
+        offsets[track] = pThis->v[kParamKickOffset + track];
+        if ((Features & kStepLookahead) && outputs[track] && -offsets[track] > advance) advance = -offsets[track];
+    }
+
+    // Density macro, read once per block: 50% plays the pattern as written and
+    // the CV adds 10% per volt. Masks are only rebuilt when the threshold moves.
+    int densityPercent = pThis->v[kParamDensity];
+    if (densityIn) {
+        const int densityCv = (int) (densityIn[0] * 10.0f);
+        if (densityCv != dtc->densityCv) {
+            dtc->densityCv = densityCv;
+            if (Features & kStepRecorder) pThis->record(kEventDensityCv, 0, densityCv);
+        }
+        densityPercent += densityCv;
+    }
+    densityPercent = densityPercent < 0 ? 0 : (densityPercent > 100 ? 100 : densityPercent);
+    const int densityThreshold = densityPercent * kMaxDensityThreshold / 100;
+    if (densityThreshold != dtc->densityThreshold) {
+        pThis->updateDensity(densityThreshold);
+    }
+
+    if (pThis->v[kParamCapture]) captureHits(pThis, busFrames, numFrames);
+
+    // Per-sample processing: clock and reset edges queue gates, which are
+    // played out after the loop
+    const uint32_t blockStart = dtc->sampleCount;
     for (int i = 0; i < numFrames; ++i) {
-        // --- 1. Handle advancing the sequencer based on clock/reset ---
-        if (resetIn && isRisingEdge(resetIn[i], dtc->resetHigh)) {
-            dtc->currentStep = 0;
-            dtc->pulseCount = 0;
+        const uint32_t now = blockStart + i;
+
+        // --- 1. Decide the next step early for the outputs that lead the clock ---
+        if ((Features & kStepLookahead) && dtc->lookaheadState == kLookaheadWaiting &&
+            (int32_t) (now - dtc->lookaheadDue) >= 0) {
+            const uint32_t predicted = dtc->lastClockSample + dtc->clockPeriod;
+            dtc->lookaheadFired = stepTracks(pThis, dtc->currentStep);
+            dtc->lookaheadState = kLookaheadDecided;
+            for (int track = 0; track < numOutputs; track++) {
+                if (offsets[track] < 0) {
+                    queueStep(dtc, track, predicted + offsets[track], dtc->lookaheadFired,
+                              gateLengthSamples, openHatGateSamples);
+                }
+            }
+        }
+
+        // --- 2. Handle advancing the sequencer based on clock/reset ---
+        bool moved = false;
+        if ((Features & kStepReset) && resetIn && isRisingEdge(resetIn[i], dtc->resetHigh)) {
+            if (Features & kStepRecorder) pThis->record(kEventReset, 0, 0, i);
+            if (leader && dtc->numSyncEdges < kMaxSyncEdges) dtc->syncEdges[dtc->numSyncEdges++] = i * 2 + 1;
+            // The step decided early won't play; take back its early gates
+            if ((Features & kStepLookahead) && dtc->lookaheadState == kLookaheadDecided) {
+                for (int track = 0; track < numOutputs; track++) {
+                    if (offsets[track] < 0) unqueueAfter(dtc->triggers[track], now);
+                }
+                if (offsets[kTrackKick] < 0) unqueueAfter(dtc->duck.hits, now);
+            }
+            dtc->lookaheadState = kLookaheadIdle;
+            resetEdge(dtc->currentStep, dtc->orderIndex, dtc->pulseCount, dtc->stepOrder);
+            pThis->startPatternCycle(true);
+            dtc->lastFireSample = now; // Place hits as if the first step fired now
+            dtc->lastFireIndex = 0;
+            moved = true;
         }
 
         if (isRisingEdge(clockIn[i], dtc->clockHigh)) {
-            dtc->pulseCount++;
+            if (Features & kStepRecorder) pThis->record(kEventClock, 0, 0, i);
+            if (leader && dtc->numSyncEdges < kMaxSyncEdges) dtc->syncEdges[dtc->numSyncEdges++] = i * 2;
+            moved = true;
+
+            // Measure the clock; after a long gap the period isn't known
+            const uint32_t interval = now - dtc->lastClockSample;
+            dtc->clockPeriod = interval < 2 * NT_globals.sampleRate ? interval : 0;
+            dtc->lastClockSample = now;
+
+            const int edgeStep = dtc->currentStep, edgeIndex = dtc->orderIndex;
+            const int edge = clockEdge(dtc->currentStep, dtc->orderIndex, dtc->pulseCount, dtc->pulsesPerStep,
+                                       dtc->stepOrder, dtc->orderLength);
 
             // Process triggers on pulse 1 for current step
-            if (dtc->pulseCount == 1) {
-                // --- Reset all trigger counters, then set them if there's a trigger
-                // on this step ---
-                dtc->kickTriggerSamples = 0;
-                dtc->snareTriggerSamples = 0;
-                dtc->hihatTriggerSamples = 0;
-                dtc->ghostTriggerSamples = 0;
-
-                // Apply probability controls as track muting
-                if (dtc->currentPattern.kick[dtc->currentStep]) {
-                    float random = (float)rand() / RAND_MAX;
-                    if (random < dtc->bdProbability) {
-                        dtc->kickTriggerSamples = gateLengthSamples;
-                    }
-                }
-                if (dtc->currentPattern.snare[dtc->currentStep]) {
-                    float random = (float)rand() / RAND_MAX;
-                    if (random < dtc->snareProbability) {
-                        dtc->snareTriggerSamples = gateLengthSamples;
+            if (edge & kEdgeFireStep) {
+                const bool decided = (Features & kStepLookahead) && dtc->lookaheadState == kLookaheadDecided;
+                const uint32_t fired = decided ? dtc->lookaheadFired : stepTracks(pThis, edgeStep);
+                dtc->lookaheadState = kLookaheadIdle;
+                dtc->lastFireSample = now;
+                dtc->lastFireIndex = edgeIndex;
+                if (Features & kStepRecorder) pThis->record(kEventStep, edgeStep, fired, i);
+
+                // Early outputs that missed the lookahead fire as soon as they can
+                for (int track = 0; track < numOutputs; track++) {
+                    if (offsets[track] >= 0) {
+                        queueStep(dtc, track, now + offsets[track], fired, gateLengthSamples, openHatGateSamples);
+                    } else if (!decided) {
+                        queueStep(dtc, track, now, fired, gateLengthSamples, openHatGateSamples);
                     }
                 }
-                if (dtc->currentPattern.hihat[dtc->currentStep]) {
-                    // Hi-hat always triggers (no probability control)
-                    dtc->hihatTriggerSamples = gateLengthSamples;
+
+                // The break slicer plays a slice on every step that fires
+                if (fired && (sliceCvOut || sliceTrigOut)) {
+                    queueTrigger(dtc->sliceChanges, now, dtc->sliceMap[edgeStep]);
+                    queueTrigger(dtc->sliceTriggers, now, gateLengthSamples);
                 }
-                if (dtc->currentPattern.ghostSnare[dtc->currentStep]) {
-                    float random = (float)rand() / RAND_MAX;
-                    if (random < dtc->ghostProbability) {
-                        dtc->ghostTriggerSamples = gateLengthSamples;
-                    }
+
+                if (midiNotes) queueMidiNotes(pThis, edgeStep, fired, now, gateLengthSamples, openHatGateSamples);
+
+                // The bass lane's note is worked out here, once per step
+                if ((bassPitchOut || bassGateOut) && bassPlays(pThis->v, edgeStep, fired)) {
+                    queueTrigger(dtc->bass.notes, now, bassPitch(pThis->v, edgeStep));
+                    queueTrigger(dtc->bass.gates, now, bassGateSamples);
                 }
             }
 
-            // Advance to next step after pulse 6
-            if (dtc->pulseCount >= dtc->pulsesPerStep) {
-                dtc->currentStep = (dtc->currentStep + 1) % dtc->currentPattern.steps;
-                dtc->pulseCount = 0; // Reset pulse count after step advance
+            // The step advanced after its last pulse; a wrap starts a new cycle
+            if (edge & kEdgeCycleStart) {
+                pThis->startPatternCycle(false);
+            }
+        }
 
-                // Check for queued pattern change at the start of a new pattern cycle
-                if (dtc->currentStep == 0 && dtc->patternChangeQueued) {
-                    pThis->generatePattern(dtc->queuedPatternId);
-                    dtc->patternChangeQueued = false;
-                    dtc->queuedPatternId = -1;
-                }
+        // The next edge fires a step: wait for its lookahead point, unless the
+        // edge is already overdue and the clock may have stopped
+        if ((Features & kStepLookahead) && moved && advance > 0 && dtc->lookaheadState == kLookaheadIdle &&
+            dtc->pulseCount == 0 && dtc->clockPeriod > 0) {
+            const uint32_t predicted = dtc->lastClockSample + dtc->clockPeriod;
+            if ((int32_t) (predicted - now) > 0) {
+                dtc->lookaheadDue = predicted - advance;
+                dtc->lookaheadState = kLookaheadWaiting;
             }
         }
+    }
 
-        // --- 3. Process active gates and set output voltages ---
-        if (dtc->kickTriggerSamples > 0) {
-            kickOut[i] = 5.0f;
-            dtc->kickTriggerSamples--;
-        } else {
-            kickOut[i] = 0.0f;
+    // --- 3. Play the queued gates ---
+    for (int track = 0; track < numOutputs; track++) {
+        renderGate(outputs[track], numFrames, blockStart, dtc->gateSamples[track], dtc->triggers[track]);
+    }
+    renderSlices(sliceCvOut, numFrames, blockStart, dtc->slice, dtc->sliceChanges);
+    renderGate(sliceTrigOut, numFrames, blockStart, dtc->sliceTrigSamples, dtc->sliceTriggers);
+    renderBass(bassPitchOut, numFrames, blockStart, dtc->bass, bassGlideSamples);
+    renderGate(bassGateOut, numFrames, blockStart, dtc->bass.gateSamples, dtc->bass.gates);
+
+    // The duck's attack and release are steps per sample; an attack of 0ms
+    // ducks at once
+    const float attackSamples = (pThis->v[kParamDuckAttack] / 1000.0f) * NT_globals.sampleRate;
+    const float releaseSamples = (pThis->v[kParamDuckRelease] / 1000.0f) * NT_globals.sampleRate;
+    renderDuck(duckOut, numFrames, blockStart, dtc->duck,
+               attackSamples > 1.0f ? 1.0f / attackSamples : 1.0f, 1.0f / releaseSamples,
+               pThis->v[kParamDuckDepth] * 0.05f);
+
+    dtc->sampleCount += numFrames;
+}
+
+template <int... Features>
+struct StepVariantTable {
+    static constexpr StepFunction variants[] = {stepVariant<Features>...};
+};
+
+template <int... Features>
+static constexpr const StepFunction *makeStepVariants(std::integer_sequence<int, Features...>) {
+    return StepVariantTable<Features...>::variants;
+}
+
+// Every variant, indexed by its feature bits
+static constexpr const StepFunction *stepVariants =
+        makeStepVariants(std::make_integer_sequence<int, kNumStepVariants>());
+
+// Picks the variant for the current routing and settings. Called whenever one
+// of the parameters behind the feature bits changes.
+void _DnbSeqAlgorithm::selectStepVariant() {
+    int features = 0;
+    if (v[kParamResetInput] > 0 || v[kParamClockSource] == kClockMidi || v[kParamSyncMode] == kSyncFollower) {
+        features |= kStepReset;
+    }
+    if (v[kParamOpenHatOutput] > 0) features |= kStepOpenHat;
+    if (recorder && v[kParamRecorder]) features |= kStepRecorder;
+    for (int track = 0; track < kNumTracks; track++) {
+        if (v[kParamKickOffset + track] < 0 && (track != kTrackOpenHat || (features & kStepOpenHat))) {
+            features |= kStepLookahead;
         }
+    }
 
-        if (dtc->snareTriggerSamples > 0) {
-            snareOut[i] = 5.0f;
-            dtc->snareTriggerSamples--;
-        } else {
-            snareOut[i] = 0.0f;
+    // Without the output the open hat gate isn't run, so don't leave one hanging
+    if (!(features & kStepOpenHat)) {
+        dtc->gateSamples[kTrackOpenHat] = 0;
+        dtc->triggers[kTrackOpenHat].head = dtc->triggers[kTrackOpenHat].tail;
+    }
+    if (!(features & kStepLookahead)) dtc->lookaheadState = kLookaheadIdle;
+    stepVariant = stepVariants[features];
+}
+
+// Silences every output and forgets any queued gates
+void _DnbSeqAlgorithm::clearTriggers() {
+    memset(dtc->gateSamples, 0, sizeof(dtc->gateSamples));
+    memset(dtc->triggers, 0, sizeof(dtc->triggers));
+    dtc->sliceTrigSamples = 0;
+    memset(&dtc->sliceChanges, 0, sizeof(dtc->sliceChanges));
+    memset(&dtc->sliceTriggers, 0, sizeof(dtc->sliceTriggers));
+    dtc->bass.gateSamples = 0;
+    memset(&dtc->bass.notes, 0, sizeof(dtc->bass.notes));
+    memset(&dtc->bass.gates, 0, sizeof(dtc->bass.gates));
+    memset(&dtc->duck.hits, 0, sizeof(dtc->duck.hits));
+    dtc->lookaheadState = kLookaheadIdle;
+}
+
+// --- MIDI Clock ---
+
+// Queues MIDI clock, Start, Continue and Stop for the next step() call
+void midiRealtime(_NT_algorithm *self, uint8_t byte) {
+    _DnbSeqAlgorithm *pThis = (_DnbSeqAlgorithm *) self;
+    MidiQueue &q = pThis->dtc->midi;
+
+    if (pThis->v[kParamClockSource] != kClockMidi) return;
+    if (byte != 0xF8 && byte != 0xFA && byte != 0xFB && byte != 0xFC) return;
+    const uint32_t tail = q.tail;
+    if (tail - __atomic_load_n(&q.head, __ATOMIC_ACQUIRE) == (uint32_t) kMidiQueueSize) return;
+    MidiEvent &e = q.events[tail & (kMidiQueueSize - 1)];
+    e.cycles = NT_getCpuCycleCount();
+    e.byte = byte;
+    __atomic_store_n(&q.tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+// Turns the MIDI bytes that arrived during the last block into clock and reset
+// pulses for this one. The first goes at the start of the block and the rest
+// keep their spacing from it, so a tick reaches the outputs less than a block
+// after it arrived; spacing across blocks moves by up to a block. Pulses are
+// one sample high with at least one low sample after; a byte with no room
+// left waits for the next block.
+static void makeMidiPulses(_DnbSeqAlgorithm *pThis, int numFrames, uint32_t blockCycles) {
+    _DnbSeqAlgorithm_DTC *dtc = pThis->dtc;
+    MidiQueue &q = dtc->midi;
+    float *clock = pThis->pulseClockFrames;
+    float *reset = pThis->pulseResetFrames;
+    memset(clock, 0, numFrames * sizeof(float));
+    memset(reset, 0, numFrames * sizeof(float));
+
+    const uint32_t span = blockCycles - dtc->lastBlockCycles;
+    const uint32_t tail = __atomic_load_n(&q.tail, __ATOMIC_ACQUIRE);
+    uint32_t head = q.head;
+    int earliest = 0, clockFree = 0, resetFree = 0, shift = -1;
+    for (; head != tail; head++) {
+        const MidiEvent &e = q.events[head & (kMidiQueueSize - 1)];
+        if ((int32_t) (e.cycles - blockCycles) >= 0) break; // Arrived during this call
+        const int32_t since = (int32_t) (e.cycles - dtc->lastBlockCycles);
+        int at = since > 0 && span > 0 ? (int) ((uint64_t) since * numFrames / span) : 0;
+        if (shift < 0) shift = at; // Where the first byte arrived in the last block
+        at -= shift;
+        if (at < earliest) at = earliest;
+        if (e.byte == 0xF8 && at < clockFree) at = clockFree;
+        if (e.byte == 0xFA && at < resetFree) at = resetFree;
+        if (at > numFrames - 2) break;
+        earliest = at;
+
+        switch (e.byte) {
+            case 0xF8: // Clock
+                if (dtc->midiRunning) {
+                    clock[at] = 5.0f;
+                    clockFree = at + 2;
+                }
+                break;
+            case 0xFA: // Start: back to step 1, which the next tick plays
+                reset[at] = 5.0f;
+                resetFree = at + 2;
+                dtc->midiRunning = true;
+                break;
+            case 0xFB: // Continue
+                dtc->midiRunning = true;
+                break;
+            case 0xFC: // Stop, which also ends any notes still sounding
+                dtc->midiRunning = false;
+                endMidiNotes(dtc, dtc->midiNotesOn);
+                break;
         }
+    }
+    __atomic_store_n(&q.head, head, __ATOMIC_RELEASE);
+}
 
-        if (dtc->hihatTriggerSamples > 0) {
-            hihatOut[i] = 5.0f;
-            dtc->hihatTriggerSamples--;
-        } else {
-            hihatOut[i] = 0.0f;
+// --- Internal Clock ---
+
+// Hands a new period to step(), which picks it up at its next block
+void _DnbSeqAlgorithm::publishTempo(uint32_t period) {
+    __atomic_store_n(&dtc->internalPeriod, period, __ATOMIC_RELEASE);
+}
+
+// Called from the UI on each tap. The tempo is the mean of the intervals
+// near their median, so one late or doubled tap doesn't pull it, and the
+// exact period goes to step() while the parameter gets the nearest BPM.
+void _DnbSeqAlgorithm::tap() {
+    const uint32_t now = NT_getCpuCycleCount();
+    const float cyclesPerSample = dtc->cyclesPerSample;
+    if (cyclesPerSample <= 0.0f) return; // No blocks timed yet
+
+    const uint32_t timeout = (uint32_t) (cyclesPerSample * NT_globals.sampleRate * (kTapTimeoutMs / 1000.0f));
+    if (numTaps > 0 && now - tapCycles[numTaps - 1] > timeout) numTaps = 0;
+    if (numTaps == kMaxTaps) {
+        memmove(tapCycles, tapCycles + 1, (kMaxTaps - 1) * sizeof(tapCycles[0]));
+        numTaps--;
+    }
+    tapCycles[numTaps++] = now;
+    if (numTaps < 2) return;
+
+    // Sort the intervals, at most seven of them
+    uint32_t intervals[kMaxTaps - 1];
+    const int numIntervals = numTaps - 1;
+    for (int i = 0; i < numIntervals; i++) {
+        const uint32_t interval = tapCycles[i + 1] - tapCycles[i];
+        int j = i;
+        for (; j > 0 && intervals[j - 1] > interval; j--) intervals[j] = intervals[j - 1];
+        intervals[j] = interval;
+    }
+    const uint32_t median = intervals[numIntervals / 2];
+    uint64_t sum = 0;
+    int count = 0;
+    for (int i = 0; i < numIntervals; i++) {
+        const uint32_t off = intervals[i] > median ? intervals[i] - median : median - intervals[i];
+        if (off <= median / kTapTolerance) {
+            sum += intervals[i];
+            count++;
+        }
+    }
+
+    float beatSamples = (float) sum / count / cyclesPerSample;
+    const float minBeat = NT_globals.sampleRate * 60.0f / kMaxTempo;
+    const float maxBeat = NT_globals.sampleRate * 60.0f / kMinTempo;
+    if (beatSamples < minBeat) beatSamples = minBeat;
+    if (beatSamples > maxBeat) beatSamples = maxBeat;
+
+    publishTempo((uint32_t) (beatSamples * (65536.0f / 24.0f)));
+    tempoTenths = (int) (NT_globals.sampleRate * 600.0f / beatSamples + 0.5f);
+    tapTempo = (tempoTenths + 5) / 10;
+    NT_setParameterFromUi(NT_algorithmIndex(this), kParamTempo + NT_parameterOffset(), tapTempo);
+}
+
+// Clock pulses for this block at the published period, one sample high. The
+// phase carries the fraction over, so pulses keep their average spacing
+// exactly; a shorter period takes effect from the pulse already due.
+static void makeInternalPulses(_DnbSeqAlgorithm *pThis, int numFrames) {
+    _DnbSeqAlgorithm_DTC *dtc = pThis->dtc;
+    float *clock = pThis->pulseClockFrames;
+    memset(clock, 0, numFrames * sizeof(float));
+    memset(pThis->pulseResetFrames, 0, numFrames * sizeof(float));
+
+    const int32_t period = (int32_t) __atomic_load_n(&dtc->internalPeriod, __ATOMIC_ACQUIRE);
+    int32_t phase = dtc->internalPhase;
+    if (phase > period) phase = period;
+    for (;;) {
+        const int at = (phase + 0xFFFF) >> 16;
+        if (at >= numFrames) break;
+        clock[at] = 5.0f;
+        phase += period;
+    }
+    dtc->internalPhase = phase - (numFrames << 16);
+}
+
+// --- Leader/Follower Sync ---
+
+// Leader: writes the block's packet to Sync Out, from the position the block
+// started at and the edges step() saw
+static void writeSync(_DnbSeqAlgorithm *pThis, float *out, int numFrames, int index, int pulse, int bar) {
+    _DnbSeqAlgorithm_DTC *dtc = pThis->dtc;
+    memset(out, 0, numFrames * sizeof(float));
+    if (numFrames < kSyncHeaderSize) return;
+    int numEdges = dtc->numSyncEdges;
+    if (numEdges > numFrames - kSyncHeaderSize) numEdges = numFrames - kSyncHeaderSize;
+    out[kSyncMagic] = kSyncMagicValue;
+    out[kSyncStep] = index;
+    out[kSyncPulse] = pulse;
+    out[kSyncBar] = bar & 0xFFFF;
+    out[kSyncNumEdges] = numEdges;
+    for (int e = 0; e < numEdges; e++) out[kSyncHeaderSize + e] = dtc->syncEdges[e];
+}
+
+// Follower: reads the leader's packet once for the block. Its edges become
+// clock and reset pulses for step(), so the follower never looks at a clock
+// of its own, and if it has drifted from the leader's position it jumps to
+// it. The position is a place in the step order, so a follower set to the
+// same direction plays the same steps. With no leader this block the follower
+// holds still.
+static void followSync(_DnbSeqAlgorithm *pThis, const float *in, int numFrames) {
+    _DnbSeqAlgorithm_DTC *dtc = pThis->dtc;
+    memset(pThis->pulseClockFrames, 0, numFrames * sizeof(float));
+    memset(pThis->pulseResetFrames, 0, numFrames * sizeof(float));
+    if (!in || numFrames < kSyncHeaderSize || (int) in[kSyncMagic] != kSyncMagicValue) return;
+
+    const int index = (int) in[kSyncStep] % dtc->orderLength;
+    const int pulse = (int) in[kSyncPulse];
+    const int bar = (int) in[kSyncBar];
+    if (index != dtc->orderIndex || pulse != dtc->pulseCount || bar != (dtc->barCount & 0xFFFF)) {
+        dtc->orderIndex = index;
+        dtc->currentStep = dtc->stepOrder[index];
+        dtc->pulseCount = pulse;
+        if (bar != (dtc->barCount & 0xFFFF)) {
+            // Trig conditions follow the bar, so they change with it mid-cycle
+            dtc->barCount = bar;
+            pThis->updateConditions();
         }
+        dtc->lookaheadState = kLookaheadIdle;
+        pThis->record(kEventSync, index, pulse | bar << 8);
+    }
+
+    int numEdges = (int) in[kSyncNumEdges];
+    if (numEdges > numFrames - kSyncHeaderSize) numEdges = numFrames - kSyncHeaderSize;
+    for (int e = 0; e < numEdges; e++) {
+        const int edge = (int) in[kSyncHeaderSize + e];
+        const int at = edge >> 1;
+        if (at < numFrames) ((edge & 1) ? pThis->pulseResetFrames : pThis->pulseClockFrames)[at] = 5.0f;
+    }
+}
+
+void step(_NT_algorithm *self, float *busFrames, int numFramesBy4) {
+    _DnbSeqAlgorithm *pThis = (_DnbSeqAlgorithm *) self;
+    _DnbSeqAlgorithm_DTC *dtc = pThis->dtc;
+    const uint32_t start = NT_getCpuCycleCount();
+    const int numFrames = numFramesBy4 * 4;
+
+    // A new direction or pattern length takes effect from the next step
+    if (dtc->orderSteps != dtc->currentPattern.steps || dtc->orderDirection != pThis->v[kParamDirection] ||
+        (dtc->orderDirection == kDirectionRandom && dtc->orderSeed != pThis->v[kParamShuffleSeed])) {
+        pThis->buildStepOrder();
+    }
 
-        if (dtc->ghostTriggerSamples > 0) {
-            ghostSnareOut[i] = 5.0f;
-            dtc->ghostTriggerSamples--;
+    // A follower's pulses come from its leader, whatever its clock source
+    const int syncMode = pThis->v[kParamSyncMode];
+    if (syncMode == kSyncFollower) {
+        followSync(pThis,
+                   pThis->v[kParamSyncInput] > 0 ? busFrames + (pThis->v[kParamSyncInput] - 1) * numFrames : nullptr,
+                   numFrames);
+    }
+    const int syncIndex = dtc->orderIndex, syncPulse = dtc->pulseCount, syncBar = dtc->barCount;
+    dtc->numSyncEdges = 0;
+
+    // Cycles per sample, which the UI times taps with
+    if (dtc->sampleCount > 0) {
+        const float cyclesPerSample = (float) (start - dtc->lastBlockCycles) / numFrames;
+        if (dtc->cyclesPerSample > 0.0f) {
+            dtc->cyclesPerSample += (cyclesPerSample - dtc->cyclesPerSample) * (1.0f / 16.0f);
         } else {
-            ghostSnareOut[i] = 0.0f;
+            dtc->cyclesPerSample = cyclesPerSample;
         }
     }
+
+    if (pThis->v[kParamClockSource] == kClockInternal && syncMode != kSyncFollower) {
+        makeInternalPulses(pThis, numFrames);
+    }
+    if (pThis->v[kParamClockSource] == kClockMidi && syncMode != kSyncFollower) {
+        makeMidiPulses(pThis, numFrames, start);
+    } else {
+        // Nothing is queued once MIDI is deselected; drop what was left
+        __atomic_store_n(&dtc->midi.head, __atomic_load_n(&dtc->midi.tail, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+    }
+    dtc->lastBlockCycles = start;
+    pThis->stepVariant(pThis, busFrames, numFrames);
+    if (dtc->midiNotesOn) endExpiredMidiNotes(dtc);
+    if (dtc->midiOut.head != dtc->midiOut.tail) flushMidiNotes(pThis);
+    if (syncMode == kSyncLeader && pThis->v[kParamSyncOutput] > 0) {
+        writeSync(pThis, busFrames + (pThis->v[kParamSyncOutput] - 1) * numFrames, numFrames,
+                  syncIndex, syncPulse, syncBar);
+    }
+
+    // CPU meter: a moving average over about 16 blocks, and the peak
+    const uint32_t cycles = NT_getCpuCycleCount() - start;
+    dtc->blockCycles += ((int32_t) (cycles - dtc->blockCycles)) / 16;
+    if (cycles > dtc->peakBlockCycles) dtc->peakBlockCycles = cycles;
 }
 
 bool draw(_NT_algorithm *self) {
@@ -866,7 +3449,8 @@ bool draw(_NT_algorithm *self) {
     int stepWidth = gridWidth / dtc->currentPattern.steps;
 
     for (int track = 0; track < 4; ++track) {
-        const bool *patternTrack = nullptr;
+        const uint32_t trackHits = dtc->currentPattern.hits[track];
+        const uint32_t playingHits = densityHits(dtc, track) & stepsMask(dtc->currentPattern.steps);
         const char *trackName = nullptr;
         int trackColor = 15; // Default color
 
@@ -878,22 +3462,18 @@ bool draw(_NT_algorithm *self) {
             case 0:
                 trackName = "KICK";
                 trackColor = 3; // Darker color for kick
-                patternTrack = dtc->currentPattern.kick;
                 break;
             case 1:
                 trackName = "SNARE";
                 trackColor = 5; // Darker color for snare
-                patternTrack = dtc->currentPattern.snare;
                 break;
             case 2:
                 trackName = "HIHAT";
                 trackColor = 7; // Darker color for hihat
-                patternTrack = dtc->currentPattern.hihat;
                 break;
             case 3:
                 trackName = "GHOST";
                 trackColor = 9; // Darker color for ghost snare
-                patternTrack = dtc->currentPattern.ghostSnare;
                 break;
         }
 
@@ -906,26 +3486,35 @@ bool draw(_NT_algorithm *self) {
                           margin + usableWidth, separatorY, 7);
         }
 
-        if (patternTrack) {
-            for (int step = 0; step < dtc->currentPattern.steps; ++step) {
-                // Step grid positioning: margin + label space + step offset, margin + title + track offset
-                int x = margin + labelWidth + step * stepWidth;
-                int y = margin + titleHeight + track * trackHeight;
-
-                // Draw background grid for all steps (darker outline)
-                NT_drawShapeI(kNT_box, x, y, x + stepWidth - 2, y + trackHeight - 2, 1);
+        for (int step = 0; step < dtc->currentPattern.steps; ++step) {
+            // Step grid positioning: margin + label space + step offset, margin + title + track offset
+            int x = margin + labelWidth + step * stepWidth;
+            int y = margin + titleHeight + track * trackHeight;
+
+            // Draw background grid for all steps (darker outline)
+            NT_drawShapeI(kNT_box, x, y, x + stepWidth - 2, y + trackHeight - 2, 1);
+
+            // Draw active steps with track-specific colors, including hits added
+            // by the density macro. Hits that density or their trig condition
+            // silence this bar are dimmed.
+            if ((trackHits | playingHits) & (1u << step)) {
+                bool playsThisBar = playingHits & dtc->conditionMask[track] & (1u << step);
+                NT_drawShapeI(kNT_rectangle, x + 1, y + 1, x + stepWidth - 3,
+                              y + trackHeight - 3, playsThisBar ? trackColor : 2);
+            }
 
-                // Draw active steps with track-specific colors
-                if (patternTrack[step]) {
-                    NT_drawShapeI(kNT_rectangle, x + 1, y + 1, x + stepWidth - 3,
-                                  y + trackHeight - 3, trackColor);
-                }
+            // Open hats share the hi-hat row, drawn brighter
+            if (track == kTrackHihat && (dtc->currentPattern.hits[kTrackOpenHat] & (1u << step))) {
+                bool playsThisBar = densityHits(dtc, kTrackOpenHat) &
+                                    dtc->conditionMask[kTrackOpenHat] & (1u << step);
+                NT_drawShapeI(kNT_rectangle, x + 1, y + 1, x + stepWidth - 3,
+                              y + trackHeight - 3, playsThisBar ? 12 : 2);
+            }
 
-                // Draw current step indicator with bright highlight
-                if (step == dtc->currentStep) {
-                    NT_drawShapeI(kNT_box, x, y, x + stepWidth - 2, y + trackHeight - 2,
-                                  15);
-                }
+            // Draw current step indicator with bright highlight
+            if (step == dtc->currentStep) {
+                NT_drawShapeI(kNT_box, x, y, x + stepWidth - 2, y + trackHeight - 2,
+                              15);
             }
         }
     }
@@ -939,6 +3528,26 @@ bool draw(_NT_algorithm *self) {
         NT_drawText(2, 26, patternNames[patternId], 15, kNT_textLeft, kNT_textTiny);
     }
 
+    // Internal clock tempo, to a tenth of a BPM once tapped
+    if (pThis->v[kParamClockSource] == kClockInternal) {
+        char text[16];
+        int len = NT_intToString(text, pThis->tempoTenths / 10);
+        text[len++] = '.';
+        text[len++] = '0' + pThis->tempoTenths % 10;
+        memcpy(text + len, " BPM", 5);
+        NT_drawText(250, 20, text, 15, kNT_textRight, kNT_textTiny);
+    }
+
+    // CPU meter: average and peak cycles per block, below the grid
+    if (pThis->v[kParamCpuMeter]) {
+        char text[32];
+        int len = NT_intToString(text, (int) dtc->blockCycles);
+        text[len++] = '/';
+        len += NT_intToString(text + len, (int) dtc->peakBlockCycles);
+        memcpy(text + len, " cyc", 5);
+        NT_drawText(250, 63, text, 15, kNT_textRight, kNT_textTiny);
+    }
+
     return true; // Hide default parameter line
 }
 
@@ -952,6 +3561,20 @@ uint32_t hasCustomUi(_NT_algorithm *self) {
 void customUi(_NT_algorithm *self, const _NT_uiData &data) {
     _DnbSeqAlgorithm *pThis = (_DnbSeqAlgorithm *) self;
 
+    // Log input for the recorder, skipping frames where nothing happened
+    if (data.controls != data.lastButtons || data.encoders[0] || data.encoders[1]) {
+        for (int pot = 0; pot < 3; pot++) {
+            if (data.controls & (kNT_potL << pot)) {
+                int32_t bits;
+                memcpy(&bits, &data.pots[pot], sizeof(bits));
+                pThis->record(kEventPot, pot, bits);
+            }
+        }
+        pThis->record(kEventUi, data.lastButtons,
+                      data.controls | (uint32_t) (uint8_t) data.encoders[0] << 16 |
+                      (uint32_t) (uint8_t) data.encoders[1] << 24);
+    }
+
     // Left encoder: Change pattern
     if (data.encoders[0] != 0) {
         int currentPattern = pThis->v[kParamPatternSelect];
@@ -961,14 +3584,25 @@ void customUi(_NT_algorithm *self, const _NT_uiData &data) {
         NT_setParameterFromUi(NT_algorithmIndex(self), kParamPatternSelect + NT_parameterOffset(), currentPattern);
     }
 
+    // Right encoder: Turn right to find the most different pattern in the
+    // library, left to find the most similar one
+    if (data.encoders[1] != 0) {
+        pThis->findByDistance(data.encoders[1] > 0);
+    }
+
     // Left encoder button: Generate variation
     if ((data.controls & kNT_encoderButtonL) && !(data.lastButtons & kNT_encoderButtonL)) {
         pThis->generateVariation();
     }
 
-    // Right encoder button: Reset pattern to default
+    // Right encoder button: Tap tempo on the internal clock, otherwise reset
+    // the pattern to default
     if ((data.controls & kNT_encoderButtonR) && !(data.lastButtons & kNT_encoderButtonR)) {
-        pThis->resetToDefault();
+        if (pThis->v[kParamClockSource] == kClockInternal) {
+            pThis->tap();
+        } else {
+            pThis->resetToDefault();
+        }
     }
 
     // Left pot: Kick drum trigger probability (0-100%)
@@ -1000,6 +3634,8 @@ void customUi(_NT_algorithm *self, const _NT_uiData &data) {
     if ((data.controls & kNT_potButtonR) && !(data.lastButtons & kNT_potButtonR)) {
         pThis->dtc->ghostProbability = 1.0f;
     }
+
+    pThis->updateGateThresholds();
 }
 
 void setupUi(_NT_algorithm *self, _NT_float3 &pots) {
@@ -1009,23 +3645,131 @@ void setupUi(_NT_algorithm *self, _NT_float3 &pots) {
     pots[2] = pThis->dtc->ghostProbability;    // Right pot: Ghost snare probability
 }
 
+// --- Serialisation ---
+
+// Trig conditions aren't parameters, so they are saved with the preset
+void serialise(_NT_algorithm *self, _NT_jsonStream &stream) {
+    _DnbSeqAlgorithm *pThis = (_DnbSeqAlgorithm *) self;
+
+    stream.addMemberName("conditions");
+    stream.openArray();
+    for (int track = 0; track < kNumTracks; track++) {
+        for (int step = 0; step < MAX_STEPS; step++) {
+            stream.addNumber((int) pThis->dtc->conditions[track][step]);
+        }
+    }
+    stream.closeArray();
+
+    // The recording, for the host replayer, only in the first save after
+    // Export Recording. It starts from the oldest snapshot whose events are
+    // all still in the ring. Loading a preset ignores it.
+    const EventRecorder *recorder = pThis->recorder;
+    if (!pThis->exportRecording) return;
+    pThis->exportRecording = false;
+    if (!recorder || recorder->numSnapshots == 0) return;
+    const uint32_t writeIndex = recorder->writeIndex;
+    const RecorderSnapshot *snapshot = &recorder->snapshots[(recorder->numSnapshots - 1) & 1];
+    if (recorder->numSnapshots > 1) {
+        const RecorderSnapshot *older = &recorder->snapshots[recorder->numSnapshots & 1];
+        if (writeIndex - older->eventIndex <= recorder->eventMask + 1) snapshot = older;
+    }
+
+    stream.addMemberName("recording");
+    stream.openObject();
+    stream.addMemberName("sampleRate");
+    stream.addNumber((int) NT_globals.sampleRate);
+    stream.addMemberName("v");
+    stream.openArray();
+    for (unsigned p = 0; p < ARRAY_SIZE(parameters); p++) {
+        stream.addNumber((int) snapshot->v[p]);
+    }
+    stream.closeArray();
+    // The DTC is saved as raw words; the replayer checks its size matches
+    stream.addMemberName("dtc");
+    stream.openArray();
+    for (unsigned i = 0; i < sizeof(snapshot->dtc) / 4; i++) {
+        int32_t word;
+        memcpy(&word, (const uint8_t *) &snapshot->dtc + i * 4, sizeof(word));
+        stream.addNumber((int) word);
+    }
+    stream.closeArray();
+    stream.addMemberName("bank");
+    stream.openArray();
+    stream.addNumber(snapshot->bankCount);
+    stream.addNumber(snapshot->bankNext);
+    for (int i = 0; i < PATTERN_BANK_SIZE; i++) {
+        stream.addNumber(snapshot->bank[i].steps);
+        for (int track = 0; track < kNumTracks; track++) {
+            stream.addNumber((int) snapshot->bank[i].hits[track]);
+        }
+    }
+    stream.closeArray();
+    // Four numbers per event: sample, type, index, value
+    stream.addMemberName("events");
+    stream.openArray();
+    for (uint32_t n = snapshot->eventIndex; n != writeIndex; n++) {
+        const RecordedEvent &e = recorder->events[n & recorder->eventMask];
+        if (__atomic_load_n(&e.seq, __ATOMIC_ACQUIRE) != n + 1) continue;
+        stream.addNumber((int) e.sample);
+        stream.addNumber((int) e.type);
+        stream.addNumber((int) e.index);
+        stream.addNumber((int) e.value);
+    }
+    stream.closeArray();
+    stream.closeObject();
+}
+
+bool deserialise(_NT_algorithm *self, _NT_jsonParse &parse) {
+    _DnbSeqAlgorithm *pThis = (_DnbSeqAlgorithm *) self;
+
+    int numMembers;
+    if (!parse.numberOfObjectMembers(numMembers)) {
+        return false;
+    }
+    for (int member = 0; member < numMembers; member++) {
+        if (parse.matchName("conditions")) {
+            int numElements;
+            if (!parse.numberOfArrayElements(numElements)) {
+                return false;
+            }
+            for (int i = 0; i < numElements; i++) {
+                int condition;
+                if (!parse.number(condition)) {
+                    return false;
+                }
+                // Ignore anything beyond the table or outside the known codes
+                if (i < kNumTracks * MAX_STEPS && condition >= 0 && condition < kNumConditions) {
+                    pThis->dtc->conditions[i / MAX_STEPS][i % MAX_STEPS] = condition;
+                }
+            }
+        } else if (!parse.skipMember()) {
+            return false;
+        }
+    }
+    pThis->updateConditions();
+    return true;
+}
+
 // --- Factory and Plugin Entry ---
 
 static const _NT_factory factory = {
     .guid = NT_MULTICHAR('T', 'h', 'D', 'B'),
     .name = "DnB Seq",
     .description = "Drum & Bass Sequencer",
-    .numSpecifications = 0,
-    .specifications = NULL,
+    .numSpecifications = ARRAY_SIZE(specifications),
+    .specifications = specifications,
     .calculateRequirements = calculateRequirements,
     .construct = construct,
     .parameterChanged = parameterChanged,
     .step = step,
     .draw = draw,
+    .midiRealtime = midiRealtime,
     .tags = kNT_tagUtility,
     .hasCustomUi = hasCustomUi,
     .customUi = customUi,
     .setupUi = setupUi,
+    .serialise = serialise,
+    .deserialise = deserialise,
 };
 
 extern "C" uintptr_t pluginEntry(_NT_selector selector, uint32_t data) {
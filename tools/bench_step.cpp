@@ -0,0 +1,282 @@
+/*
+MIT License
+
+Copyright (c) 2025 Thorinside
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Step benchmark: for several routings, runs the same clock and reset through
+// the step() variant the plugin selects and through the general variant with
+// every feature compiled in. The outputs must match sample for sample; the
+// time per block of each is printed side by side.
+//
+// It then times find similar over a bank of 10,000 random patterns, with the
+// plugin's popcount and with the compiler's __builtin_popcount, and breeding
+// every pair of built-in patterns, to show how many candidates fit the
+// breeding search's share of a UI frame.
+//
+//   bench_step [--seconds N]
+
+#include "../dnb_seq.cpp"
+#include "nt_host.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+
+const int kBenchResetBus = 2;
+const int kBenchOpenHatBus = 19;
+const int kBenchRounds = 5; // Best of, to keep scheduler noise out
+const float kBenchTempo = 174.0f;
+const int kBenchPulseSamples = 24;
+const int kPulsesPerQuarter = 24; // Six pulses per 16th step
+const int kBenchBankSize = 10000;
+const int kBenchBankQueries = 100;
+const double kBenchCoreHz = 600e6; // The module's Cortex-M7
+
+struct BenchConfig {
+    const char *name;
+    bool reset;
+    bool openHat;
+    bool recorder;
+};
+
+static const BenchConfig configs[] = {
+    {"minimal", false, false, false},
+    {"reset", true, false, false},
+    {"open hat", false, true, false},
+    {"reset + open hat", true, true, false},
+    {"everything", true, true, true},
+};
+
+// A 24 PPQN clock and a reset every 16 bars, one bus each
+struct BenchInput {
+    std::vector<float> clock, reset;
+
+    explicit BenchInput(int samples) : clock(samples), reset(samples) {
+        const double period = kHostSampleRate * 60.0 / kBenchTempo / kPulsesPerQuarter;
+        for (long long pulse = 0;; pulse++) {
+            const long long start = (long long) (pulse * period);
+            if (start >= samples) break;
+            const bool resetPulse = pulse % (16 * 4 * kPulsesPerQuarter) == 0;
+            for (long long s = start; s < std::min(start + kBenchPulseSamples, (long long) samples); s++) {
+                clock[s] = 5.0f;
+                if (resetPulse) reset[s] = 5.0f;
+            }
+        }
+    }
+};
+
+struct BenchInstance {
+    HostInstance instance;
+    std::vector<float> busses;
+
+    BenchInstance(const BenchConfig &config, bool general)
+        : instance({config.recorder ? kMaxRecorderSize : 0}), busses(kHostNumBusses * kHostMaxFramesPerStep) {
+        _DnbSeqAlgorithm *alg = (_DnbSeqAlgorithm *) instance.algorithm;
+        alg->seedRandom(1);
+        if (config.reset) instance.setParameter(kParamResetInput, kBenchResetBus);
+        if (config.openHat) instance.setParameter(kParamOpenHatOutput, kBenchOpenHatBus);
+        if (config.recorder) instance.setParameter(kParamRecorder, 1);
+        instance.setParameter(kParamPatternSelect, 8); // Amen has open hats
+        if (general) alg->stepVariant = stepVariants[kStepAllFeatures];
+    }
+
+    void block(const BenchInput &input, int start) {
+        const int frames = kHostMaxFramesPerStep;
+        memcpy(&busses[(instance.v[kParamClockInput] - 1) * frames], &input.clock[start], frames * sizeof(float));
+        if (instance.v[kParamResetInput] > 0) {
+            memcpy(&busses[(instance.v[kParamResetInput] - 1) * frames], &input.reset[start], frames * sizeof(float));
+        }
+        instance.step(busses.data(), frames);
+    }
+};
+
+// Seconds for one pass over the input
+static double timePass(BenchInstance &bench, const BenchInput &input) {
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t t = 0; t + kHostMaxFramesPerStep <= input.clock.size(); t += kHostMaxFramesPerStep) {
+        bench.block(input, (int) t);
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// patternDistance() with the compiler's popcount in place of countHits()
+static inline int builtinDistance(const DrumPattern &a, const DrumPattern &b) {
+    const uint32_t allSteps = stepsMask(a.steps);
+    int d = 0;
+    for (int track = 0; track < kNumTracks; track++) {
+        d += trackWeights[track] * __builtin_popcount((a.hits[track] ^ b.hits[track]) & allSteps);
+    }
+    return d;
+}
+
+// The scan findByDistance() makes, over a bank of any size
+template <int (*Distance)(const DrumPattern &, const DrumPattern &)>
+static int nearestInBank(const std::vector<DrumPattern> &bank, const DrumPattern &current) {
+    int bestIndex = -1, bestDistance = 0;
+    for (int i = 0; i < (int) bank.size(); i++) {
+        const int d = Distance(current, bank[i]);
+        if (d == 0) continue;
+        if (bestIndex < 0 || d < bestDistance) {
+            bestIndex = i;
+            bestDistance = d;
+        }
+    }
+    return bestIndex;
+}
+
+// Seconds for one nearest-pattern search per query, summing the results so
+// the searches can't be optimised away
+template <int (*Distance)(const DrumPattern &, const DrumPattern &)>
+static double timeBankSearch(const std::vector<DrumPattern> &bank, const std::vector<DrumPattern> &queries,
+                             long &checksum) {
+    const auto start = std::chrono::steady_clock::now();
+    checksum = 0;
+    for (const DrumPattern &query : queries) {
+        checksum += nearestInBank<Distance>(bank, query);
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Random 16-step patterns, each track about a quarter full
+static std::vector<DrumPattern> randomPatterns(DnbRandom &rng, int count) {
+    std::vector<DrumPattern> patterns(count);
+    for (DrumPattern &p : patterns) {
+        p.steps = 16;
+        for (int track = 0; track < kNumTracks; track++) {
+            p.hits[track] = (uint32_t) (rng.next() & rng.next()) & stepsMask(p.steps);
+        }
+    }
+    return patterns;
+}
+
+static int benchBankSearch() {
+    DnbRandom rng;
+    rng.seed(1);
+    const std::vector<DrumPattern> bank = randomPatterns(rng, kBenchBankSize);
+    const std::vector<DrumPattern> queries = randomPatterns(rng, kBenchBankQueries);
+
+    double bestPlugin = 1e30, bestBuiltin = 1e30;
+    long pluginSum = 0, builtinSum = 0;
+    for (int round = 0; round < kBenchRounds; round++) {
+        bestPlugin = std::min(bestPlugin, timeBankSearch<patternDistance>(bank, queries, pluginSum));
+        bestBuiltin = std::min(bestBuiltin, timeBankSearch<builtinDistance>(bank, queries, builtinSum));
+    }
+
+    printf("Find similar over %d patterns, best of %d\n", kBenchBankSize, kBenchRounds);
+    if (pluginSum != builtinSum) {
+        printf("  countHits and __builtin_popcount find different patterns\n");
+        return 1;
+    }
+    printf("  %-18s %12.1f us/search %8.2f ns/pattern\n", "countHits", bestPlugin / queries.size() * 1e6,
+           bestPlugin / queries.size() / kBenchBankSize * 1e9);
+    printf("  %-18s %12.1f us/search %8.2f ns/pattern\n", "__builtin_popcount", bestBuiltin / queries.size() * 1e6,
+           bestBuiltin / queries.size() / kBenchBankSize * 1e9);
+    return 0;
+}
+
+static int benchBreeding() {
+    HostInstance instance;
+    _DnbSeqAlgorithm *alg = (_DnbSeqAlgorithm *) instance.algorithm;
+    alg->seedRandom(1);
+
+    double best = 1e30;
+    long candidates = 0;
+    int breeds = 0;
+    for (int round = 0; round < kBenchRounds; round++) {
+        candidates = 0;
+        breeds = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (int a = 0; a < NUM_BUILTIN_PATTERNS; a++) {
+            for (int b = 0; b < NUM_BUILTIN_PATTERNS; b++) {
+                if (a == b) continue;
+                candidates += alg->breedPatterns(a, b);
+                breeds++;
+            }
+        }
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    const double perCandidate = best / candidates;
+    const double frameBudget = kBreedCycleBudget / kBenchCoreHz;
+    printf("Breeding %d parent pairs, best of %d\n", breeds, kBenchRounds);
+    printf("  %.1f candidates per Breed (cap %d), %.1f ns per candidate\n", (double) candidates / breeds,
+           kMaxBreedCandidates, perCandidate * 1e9);
+    printf("  the %u-cycle budget is %.2f ms of a UI frame at %.0f MHz: %.0f candidates at this speed\n",
+           kBreedCycleBudget, frameBudget * 1e3, kBenchCoreHz / 1e6, frameBudget / perCandidate);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int seconds = 600;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--seconds") && i + 1 < argc) {
+            seconds = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: bench_step [--seconds N]\n");
+            return 1;
+        }
+    }
+    const int samples = std::max(seconds, 1) * kHostSampleRate / kHostMaxFramesPerStep * kHostMaxFramesPerStep;
+    const BenchInput input(samples);
+    const double blocks = (double) samples / kHostMaxFramesPerStep;
+
+    printf("%d s of clock at %.0f BPM, %d-frame blocks, best of %d\n", seconds, kBenchTempo,
+           kHostMaxFramesPerStep, kBenchRounds);
+    printf("  %-18s %9s %12s %12s %8s\n", "routing", "variant", "ns/block", "general", "speedup");
+
+    int failures = 0;
+    for (const BenchConfig &config : configs) {
+        // Both variants must produce the same outputs from the same state
+        BenchInstance selected(config, false), general(config, true);
+        int mismatch = -1;
+        for (int t = 0; t < samples && mismatch < 0; t += kHostMaxFramesPerStep) {
+            selected.block(input, t);
+            general.block(input, t);
+            if (selected.busses != general.busses) mismatch = t;
+        }
+        if (mismatch >= 0) {
+            printf("  %-18s outputs differ from the general loop in the block at sample %d\n", config.name, mismatch);
+            failures++;
+            continue;
+        }
+
+        BenchInstance timedSelected(config, false), timedGeneral(config, true);
+        double bestSelected = 1e30, bestGeneral = 1e30;
+        for (int round = 0; round < kBenchRounds; round++) {
+            bestSelected = std::min(bestSelected, timePass(timedSelected, input));
+            bestGeneral = std::min(bestGeneral, timePass(timedGeneral, input));
+        }
+
+        int features = 0;
+        for (int f = 0; f < kNumStepVariants; f++) {
+            if (stepVariants[f] == ((_DnbSeqAlgorithm *) timedSelected.instance.algorithm)->stepVariant) features = f;
+        }
+        printf("  %-18s %9d %12.1f %12.1f %7.2fx\n", config.name, features, bestSelected / blocks * 1e9,
+               bestGeneral / blocks * 1e9, bestGeneral / bestSelected);
+    }
+
+    printf("\n");
+    failures += benchBankSearch();
+    printf("\n");
+    failures += benchBreeding();
+    return failures ? 1 : 0;
+}
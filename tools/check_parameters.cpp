@@ -0,0 +1,246 @@
+/*
+MIT License
+
+Copyright (c) 2025 Thorinside
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Parameter checker: the parameters[] array must line up with the parameter
+// enum, since the plugin reads v[] by enum index and the module shows
+// parameters[] by array index. An entry out of place gives every parameter
+// after it another's name, range and default. Checks, for every enum index:
+//
+//   - the entry at that index has the name it is listed under here
+//   - its default is within its range, and an enum has a string per value
+//   - every page entry is a valid index, and no parameter is on two pages
+//
+// and that an instance left at its defaults sends no MIDI and reserves no
+// recorder memory. Exits non-zero on any failure.
+//
+//   check_parameters
+
+#include "../dnb_seq.cpp"
+#include "nt_host.h"
+
+#include <cstring>
+
+const int kCheckFrames = 128;
+const int kCheckSeconds = 2;
+
+struct ExpectedParameter {
+    int index;
+    const char *name;
+};
+
+// Every parameter by its enum name; keep in enum order when adding one
+static const ExpectedParameter expected[] = {
+    {kParamClockInput, "Clock In"},
+    {kParamResetInput, "Reset In"},
+    {kParamKickOutput, "Kick Out"},
+    {kParamSnareOutput, "Snare Out"},
+    {kParamHihatOutput, "Hi-hat Out"},
+    {kParamGhostSnareOutput, "Ghost Snare Out"},
+    {kParamPatternSelect, "Pattern"},
+    {kParamGenerateVariation, "Vary Pattern"},
+    {kParamResetToDefault, "Reset Pattern"},
+    {kParamDirection, "Direction"},
+    {kParamShuffleSeed, "Shuffle Seed"},
+    {kParamDiceMode, "Dice"},
+    {kParamDiceLock, "Dice Lock Bars"},
+    {kParamCondTrack, "Cond Track"},
+    {kParamCondStep, "Cond Step"},
+    {kParamCondition, "Condition"},
+    {kParamFill, "Fill"},
+    {kParamHihatProbability, "Hi-hat Prob"},
+    {kParamOpenHatOutput, "Open Hat Out"},
+    {kParamOpenHatGate, "Open Hat Gate"},
+    {kParamSliceCvOutput, "Slice CV Out"},
+    {kParamSliceTrigOutput, "Slice Trig Out"},
+    {kParamBassPitchOutput, "Bass Pitch Out"},
+    {kParamBassGateOutput, "Bass Gate Out"},
+    {kParamBassSource, "Bass Source"},
+    {kParamBassRiff, "Bass Riff"},
+    {kParamBassRoot, "Bass Root"},
+    {kParamBassScale, "Bass Scale"},
+    {kParamBassOctave, "Bass Octave"},
+    {kParamBassGlide, "Bass Glide"},
+    {kParamBassGate, "Bass Gate"},
+    {kParamDuckOutput, "Duck Out"},
+    {kParamDuckDepth, "Duck Depth"},
+    {kParamDuckAttack, "Duck Attack"},
+    {kParamDuckRelease, "Duck Release"},
+    {kParamClockSource, "Clock Source"},
+    {kParamTempo, "Tempo"},
+    {kParamMidiDestination, "MIDI Dest"},
+    {kParamMidiVelocity, "MIDI Velocity"},
+    {kParamKickMidiChannel, "Kick MIDI Ch"},
+    {kParamKickMidiNote, "Kick Note"},
+    {kParamSnareMidiChannel, "Snare MIDI Ch"},
+    {kParamSnareMidiNote, "Snare Note"},
+    {kParamHihatMidiChannel, "Hi-hat MIDI Ch"},
+    {kParamHihatMidiNote, "Hi-hat Note"},
+    {kParamGhostMidiChannel, "Ghost MIDI Ch"},
+    {kParamGhostMidiNote, "Ghost Note"},
+    {kParamOpenHatMidiChannel, "Open Hat MIDI Ch"},
+    {kParamOpenHatMidiNote, "Open Hat Note"},
+    {kParamSyncMode, "Sync Mode"},
+    {kParamSyncInput, "Sync In"},
+    {kParamSyncOutput, "Sync Out"},
+    {kParamDensity, "Density"},
+    {kParamDensityInput, "Density CV In"},
+    {kParamBreedParentA, "Breed A"},
+    {kParamBreedParentB, "Breed B"},
+    {kParamBreed, "Breed"},
+    {kParamCapture, "Capture"},
+    {kParamKickCaptureInput, "Kick Capture In"},
+    {kParamSnareCaptureInput, "Snare Capture In"},
+    {kParamHihatCaptureInput, "Hi-hat Capture In"},
+    {kParamGhostCaptureInput, "Ghost Capture In"},
+    {kParamOpenHatCaptureInput, "Open Hat Capture In"},
+    {kParamKickOffset, "Kick Offset"},
+    {kParamSnareOffset, "Snare Offset"},
+    {kParamHihatOffset, "Hi-hat Offset"},
+    {kParamGhostOffset, "Ghost Offset"},
+    {kParamOpenHatOffset, "Open Hat Offset"},
+    {kParamRecorder, "Recorder"},
+    {kParamCpuMeter, "CPU Meter"},
+    {kParamExportRecording, "Export Recording"},
+};
+
+static int failures = 0;
+
+static void fail(const char *what, int index) {
+    printf("FAILED: %s, index %d (\"%s\")\n", what, index,
+           index >= 0 && index < (int) ARRAY_SIZE(parameters) ? parameters[index].name : "?");
+    failures++;
+}
+
+static void checkNames() {
+    const int count = (int) ARRAY_SIZE(parameters);
+    if ((int) ARRAY_SIZE(expected) != count) {
+        printf("FAILED: %d parameters in the array, %d in the enum\n", count, (int) ARRAY_SIZE(expected));
+        failures++;
+    }
+    for (int i = 0; i < (int) ARRAY_SIZE(expected); i++) {
+        const ExpectedParameter &e = expected[i];
+        if (e.index != i) fail("listed out of enum order", e.index);
+        if (e.index >= count) {
+            fail("enum index past the end of the array", e.index);
+            continue;
+        }
+        if (strcmp(parameters[e.index].name, e.name) != 0) {
+            printf("FAILED: index %d should be \"%s\" but is \"%s\"\n", e.index, e.name,
+                   parameters[e.index].name);
+            failures++;
+        }
+    }
+}
+
+static void checkRanges() {
+    for (int i = 0; i < (int) ARRAY_SIZE(parameters); i++) {
+        const _NT_parameter &p = parameters[i];
+        if (p.min > p.max || p.def < p.min || p.def > p.max) fail("default outside the range", i);
+        if (p.unit == kNT_unitEnum) {
+            int strings = 0;
+            while (p.enumStrings && p.enumStrings[strings]) strings++;
+            if (strings != p.max - p.min + 1) fail("enum strings don't match the range", i);
+        }
+    }
+}
+
+static void checkPages() {
+    std::vector<int> seen(ARRAY_SIZE(parameters), 0);
+    for (uint32_t page = 0; page < parameterPages.numPages; page++) {
+        const _NT_parameterPage &pg = parameterPages.pages[page];
+        for (int j = 0; j < pg.numParams; j++) {
+            const int index = pg.params[j];
+            if (index >= (int) ARRAY_SIZE(parameters)) {
+                printf("FAILED: page %s lists index %d\n", pg.name, index);
+                failures++;
+            } else if (seen[index]++) {
+                fail("on more than one page", index);
+            }
+        }
+    }
+}
+
+// MIDI output is opt-in: a default instance playing its pattern sends nothing
+static void checkDefaultsSilent() {
+    HostInstance instance;
+    std::vector<float> busses(kHostNumBusses * kCheckFrames);
+    const int pulseSamples = kHostSampleRate * 60 / 174 / 24;
+    const long before = hostMidiMessages;
+    for (int t = 0; t < kHostSampleRate * kCheckSeconds; t += kCheckFrames) {
+        std::fill(busses.begin(), busses.end(), 0.0f);
+        for (int i = 0; i < kCheckFrames; i++) {
+            if ((t + i) % pulseSamples < 24) busses[(instance.v[kParamClockInput] - 1) * kCheckFrames + i] = 5.0f;
+        }
+        instance.step(busses.data(), kCheckFrames);
+    }
+    if (hostMidiMessages != before) {
+        printf("FAILED: a default instance sent %ld MIDI messages in %d s\n", hostMidiMessages - before,
+               kCheckSeconds);
+        failures++;
+    }
+    if (instance.req.dram != 0) {
+        printf("FAILED: a default instance reserves %u bytes of DRAM\n", (unsigned) instance.req.dram);
+        failures++;
+    }
+}
+
+// Every MIDI note ends after its gate, so none is left sounding once the
+// clock stops on the downbeat of the second bar
+static void checkNotesEnd() {
+    HostInstance instance;
+    for (int track = 0; track < kNumTracks; track++) instance.setParameter(kParamKickMidiChannel + 2 * track, 1);
+    std::vector<float> busses(kHostNumBusses * kCheckFrames);
+    const int pulseSamples = kHostSampleRate * 60 / 174 / 24;
+    const long before = hostMidiMessages;
+    for (int t = 0; t < kHostSampleRate * kCheckSeconds; t += kCheckFrames) {
+        std::fill(busses.begin(), busses.end(), 0.0f);
+        for (int i = 0; i < kCheckFrames && t + i <= 96 * pulseSamples; i++) {
+            if ((t + i) % pulseSamples < 24) busses[(instance.v[kParamClockInput] - 1) * kCheckFrames + i] = 5.0f;
+        }
+        instance.step(busses.data(), kCheckFrames);
+    }
+    if (hostMidiMessages == before) {
+        printf("FAILED: no MIDI notes were sent with every channel set\n");
+        failures++;
+    }
+    if (hostMidiNotesSounding != 0) {
+        printf("FAILED: %ld MIDI notes still sounding after the clock stopped\n", hostMidiNotesSounding);
+        failures++;
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1) {
+        fprintf(stderr, "usage: check_parameters\n");
+        return 1;
+    }
+    checkNames();
+    checkRanges();
+    checkPages();
+    checkDefaultsSilent();
+    checkNotesEnd();
+    printf("%zu parameters on %u pages: %s\n", ARRAY_SIZE(parameters), parameterPages.numPages,
+           failures ? "FAILED" : "all checks pass");
+    return failures ? 1 : 0;
+}
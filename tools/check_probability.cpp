@@ -0,0 +1,294 @@
+/*
+MIT License
+
+Copyright (c) 2025 Thorinside
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Probability checker: runs triggers through the probability gates in step()
+// and tests the results statistically.
+//
+//   - hit rates at many pot settings, per hit and per bar, with a chi-square
+//     test per track; 0% and 100% must be exact
+//   - correlation between tracks, and of each track with its own previous
+//     step and previous bar, at 50%
+//   - how often a whole bar repeats at 50%, against the birthday-problem
+//     expectation
+//   - closed hat rates with an open hat on every step, with the open hat
+//     routed (it chokes the closed hat) and unrouted (one decision per step)
+//   - the period of the gate generator, measured by running it round
+//
+// A result outside its bound is marked FAIL and the exit status is non-zero.
+//
+//   check_probability [--trials N] [--seed S] [--skip-period]
+
+#include "../dnb_seq.cpp"
+#include "nt_host.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <set>
+
+const int kCheckFrames = 4;
+const int kCheckTracks = 4; // Kick, snare, closed hat, ghost; the open hat shares the hat probability
+const int kCheckOpenHatBus = 19;
+const double kMinPValue = 1e-4; // Chance of a false alarm per test
+const double kMaxSigmas = 5.0; // Bound on correlations, in standard errors
+
+static const float kSettings[] = {0.0f, 0.001f, 0.01f, 0.1f, 0.25f, 0.5f, 0.75f, 0.9f, 0.99f, 0.999f, 1.0f};
+
+static int failures = 0;
+
+static const char *verdict(bool ok) {
+    if (!ok) failures++;
+    return ok ? "ok" : "FAIL";
+}
+
+// --- Driving the Plugin ---
+
+struct Checker {
+    HostInstance instance;
+    _DnbSeqAlgorithm *alg;
+    std::vector<float> busses;
+
+    explicit Checker(uint32_t seed, bool openHats = false) : busses(kHostNumBusses * kCheckFrames) {
+        alg = (_DnbSeqAlgorithm *) instance.algorithm;
+
+        // Every step of a 32-step bar has a kick, snare, hat and ghost, and
+        // optionally an open hat; each clock pulse is a step
+        DrumPattern p;
+        memset(&p, 0, sizeof(p));
+        p.steps = MAX_STEPS;
+        for (int track = 0; track < kCheckTracks; track++) p.hits[track] = 0xFFFFFFFFu;
+        if (openHats) p.hits[kTrackOpenHat] = 0xFFFFFFFFu;
+        alg->dtc->basePattern = p;
+        alg->dtc->currentPattern = p;
+        alg->buildMutations();
+        alg->buildDensityRanks();
+        alg->updateDensity(50 * kMaxDensityThreshold / 100);
+        alg->dtc->pulsesPerStep = 1;
+        alg->seedRandom(seed);
+    }
+
+    void setProbability(float p, bool perBar) {
+        alg->dtc->bdProbability = p;
+        alg->dtc->snareProbability = p;
+        alg->dtc->hihatProbability = p;
+        alg->dtc->ghostProbability = p;
+        alg->updateGateThresholds();
+        instance.setParameter(kParamDiceMode, perBar ? kDicePerBar : kDicePerHit);
+        instance.setParameter(kParamDiceLock, 0);
+        alg->dtc->currentStep = 0;
+        alg->dtc->orderIndex = 0;
+        alg->dtc->pulseCount = 0;
+        if (perBar) alg->rollDice();
+    }
+
+    // One clock pulse; returns the tracks whose gates opened
+    uint32_t trigger() {
+        std::fill(busses.begin(), busses.end(), 0.0f);
+        busses[(instance.v[kParamClockInput] - 1) * kCheckFrames] = 5.0f;
+        instance.step(busses.data(), kCheckFrames);
+
+        static const int outputs[kNumTracks] = {
+            kParamKickOutput, kParamSnareOutput, kParamHihatOutput, kParamGhostSnareOutput, kParamOpenHatOutput,
+        };
+        uint32_t fired = 0;
+        for (int track = 0; track < kNumTracks; track++) {
+            const int bus = instance.v[outputs[track]];
+            if (bus > 0 && busses[(bus - 1) * kCheckFrames] > 1.0f) fired |= 1u << track;
+        }
+        return fired;
+    }
+};
+
+// --- Tests ---
+
+// Chi-square with one degree of freedom for k hits in n trials at rate p
+static double chiSquarePValue(long long k, long long n, double p) {
+    const double hits = n * p, misses = n * (1.0 - p);
+    const double chi2 = (k - hits) * (k - hits) / hits + ((n - k) - misses) * ((n - k) - misses) / misses;
+    return std::erfc(std::sqrt(chi2 / 2.0));
+}
+
+static void checkHitRates(Checker &checker, long long trials) {
+    static const char *const names[kCheckTracks] = {"kick", "snare", "hat", "ghost"};
+    printf("Hit rates over %lld triggers per setting\n", trials);
+    printf("  %-8s %8s  %-6s %10s %10s  %s\n", "mode", "setting", "track", "rate", "p-value", "");
+
+    for (int perBar = 0; perBar <= 1; perBar++) {
+        for (float p : kSettings) {
+            checker.setProbability(p, perBar);
+            long long hits[kCheckTracks] = {0};
+            for (long long i = 0; i < trials; i++) {
+                const uint32_t fired = checker.trigger();
+                for (int track = 0; track < kCheckTracks; track++) hits[track] += (fired >> track) & 1;
+            }
+            for (int track = 0; track < kCheckTracks; track++) {
+                const double rate = (double) hits[track] / trials;
+                if (p == 0.0f || p == 1.0f) {
+                    // The ends must be exact, not just likely
+                    const bool ok = hits[track] == (p == 0.0f ? 0 : trials);
+                    printf("  %-8s %8.3f  %-6s %10.6f %10s  %s\n", perBar ? "per bar" : "per hit", p,
+                           names[track], rate, "exact", verdict(ok));
+                } else {
+                    const double pValue = chiSquarePValue(hits[track], trials, p);
+                    printf("  %-8s %8.3f  %-6s %10.6f %10.4f  %s\n", perBar ? "per bar" : "per hit", p,
+                           names[track], rate, pValue, verdict(pValue >= kMinPValue));
+                }
+            }
+        }
+    }
+}
+
+static double correlation(const std::vector<uint8_t> &a, const std::vector<uint8_t> &b, size_t lag) {
+    const size_t n = a.size() - lag;
+    double sa = 0, sb = 0, sab = 0, saa = 0, sbb = 0;
+    for (size_t i = 0; i < n; i++) {
+        const double x = a[i + lag], y = b[i];
+        sa += x;
+        sb += y;
+        sab += x * y;
+        saa += x * x;
+        sbb += y * y;
+    }
+    const double cov = sab / n - (sa / n) * (sb / n);
+    const double va = saa / n - (sa / n) * (sa / n), vb = sbb / n - (sb / n) * (sb / n);
+    return cov / std::sqrt(va * vb);
+}
+
+static void checkCorrelation(Checker &checker, long long trials) {
+    static const char *const names[kCheckTracks] = {"kick", "snare", "hat", "ghost"};
+    checker.setProbability(0.5f, false);
+    std::vector<uint8_t> decisions[kCheckTracks];
+    for (int track = 0; track < kCheckTracks; track++) decisions[track].resize(trials);
+    for (long long i = 0; i < trials; i++) {
+        const uint32_t fired = checker.trigger();
+        for (int track = 0; track < kCheckTracks; track++) decisions[track][i] = (fired >> track) & 1;
+    }
+
+    const double bound = kMaxSigmas / std::sqrt((double) trials);
+    printf("\nCorrelation at 50%% over %lld triggers (bound +/-%.5f)\n", trials, bound);
+    for (int a = 0; a < kCheckTracks; a++) {
+        for (int b = a + 1; b < kCheckTracks; b++) {
+            const double r = correlation(decisions[a], decisions[b], 0);
+            printf("  %-5s / %-5s     %+9.5f  %s\n", names[a], names[b], r, verdict(std::fabs(r) <= bound));
+        }
+    }
+    for (int track = 0; track < kCheckTracks; track++) {
+        const double step = correlation(decisions[track], decisions[track], 1);
+        const double bar = correlation(decisions[track], decisions[track], MAX_STEPS);
+        printf("  %-5s last step    %+9.5f  %s\n", names[track], step, verdict(std::fabs(step) <= bound));
+        printf("  %-5s last bar     %+9.5f  %s\n", names[track], bar, verdict(std::fabs(bar) <= bound));
+    }
+}
+
+// With 2^32 equally likely kick bars, n bars should repeat about n^2 / 2^33
+// times; more means the crowd hears the same "random" bar again
+static void checkBarRepeats(Checker &checker, long long trials) {
+    checker.setProbability(0.5f, false);
+    const long long bars = trials / MAX_STEPS;
+    std::set<uint32_t> seen;
+    long long repeats = 0;
+    for (long long bar = 0; bar < bars; bar++) {
+        uint32_t kicks = 0;
+        for (int step = 0; step < MAX_STEPS; step++) kicks |= (checker.trigger() & 1u) << step;
+        if (!seen.insert(kicks).second) repeats++;
+    }
+    const double expected = (double) bars * bars / 8589934592.0;
+    const double bound = expected + 6.0 * std::sqrt(expected) + 3.0;
+    printf("\nRepeated kick bars at 50%% over %lld bars: %lld, expected %.2f  %s\n",
+           bars, repeats, expected, verdict(repeats <= bound));
+}
+
+// Closed hat rates with an open hat on every step as well. Routed, the open
+// hat fires at the hat probability p and chokes the closed hat, which fires
+// at p(1 - p). Unrouted, open hats play on the hi-hat output but the step is
+// decided once, so the hat fires at p and not at 1 - (1 - p)^2.
+static void checkOpenHat(uint32_t seed, long long trials) {
+    static const float settings[] = {0.25f, 0.5f, 0.75f};
+    printf("\nClosed hat with an open hat on every step, over %lld triggers per setting\n", trials);
+    printf("  %-8s %-9s %8s %10s %10s %10s  %s\n", "mode", "open hat", "setting", "expected", "rate", "p-value", "");
+
+    for (int routed = 0; routed <= 1; routed++) {
+        for (int perBar = 0; perBar <= 1; perBar++) {
+            for (float p : settings) {
+                Checker checker(seed, true);
+                if (routed) checker.instance.setParameter(kParamOpenHatOutput, kCheckOpenHatBus);
+                checker.setProbability(p, perBar);
+                long long hats = 0;
+                for (long long i = 0; i < trials; i++) hats += (checker.trigger() >> kTrackHihat) & 1;
+
+                const double expected = routed ? p * (1.0 - p) : p;
+                const double pValue = chiSquarePValue(hats, trials, expected);
+                printf("  %-8s %-9s %8.3f %10.6f %10.6f %10.4f  %s\n", perBar ? "per bar" : "per hit",
+                       routed ? "routed" : "unrouted", p, expected, (double) hats / trials, pValue,
+                       verdict(pValue >= kMinPValue));
+            }
+        }
+    }
+}
+
+static void checkPeriod(uint32_t seed) {
+    const uint32_t start = gateSeed(seed, 0);
+    uint32_t state = start;
+    uint64_t period = 0;
+    do {
+        nextGate(state);
+        period++;
+    } while (state != start && period <= 0xFFFFFFFFull);
+    printf("\nGate generator period: %llu (2^32 - 1 expected)  %s\n",
+           (unsigned long long) period, verdict(period == 0xFFFFFFFFull));
+
+    // The variation generator's period is too long to run; check the
+    // Hull-Dobell conditions for a full 2^64 period instead
+    const uint64_t multiplier = 6364136223846793005ULL, increment = 1;
+    printf("Variation generator: full 2^64 period by Hull-Dobell  %s\n",
+           verdict((increment & 1) && (multiplier - 1) % 4 == 0));
+}
+
+int main(int argc, char **argv) {
+    long long trials = 1000000;
+    uint32_t seed = 1;
+    bool period = true;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--skip-period")) {
+            period = false;
+        } else if (!strcmp(argv[i], "--trials") && i + 1 < argc) {
+            trials = atoll(argv[++i]);
+        } else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            seed = (uint32_t) strtoul(argv[++i], nullptr, 0);
+        } else {
+            fprintf(stderr, "usage: check_probability [--trials N] [--seed S] [--skip-period]\n");
+            return 1;
+        }
+    }
+    if (trials < MAX_STEPS * 2) trials = MAX_STEPS * 2;
+
+    static Checker checker(seed);
+    checkHitRates(checker, trials);
+    checkCorrelation(checker, trials);
+    checkBarRepeats(checker, trials);
+    checkOpenHat(seed, trials);
+    if (period) checkPeriod(seed);
+
+    printf("\n%s: %d failed\n", failures ? "FAILED" : "passed", failures);
+    return failures ? 1 : 0;
+}
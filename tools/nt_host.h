@@ -0,0 +1,170 @@
+/*
+MIT License
+
+Copyright (c) 2025 Thorinside
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Host stand-ins for the disting NT firmware, so the host tools can build the
+// plugin source unchanged and run it on a desktop machine. Include this after
+// dnb_seq.cpp in exactly one translation unit.
+
+#ifndef DNB_SEQ_NT_HOST_H
+#define DNB_SEQ_NT_HOST_H
+
+#include <chrono>
+#include <cstdio>
+#include <initializer_list>
+#include <vector>
+
+#include <distingnt/api.h>
+#include <distingnt/serialisation.h>
+
+const int kHostSampleRate = 48000;
+const int kHostMaxFramesPerStep = 128;
+const int kHostNumBusses = 28;
+
+const _NT_globals NT_globals = {kHostSampleRate, kHostMaxFramesPerStep, nullptr, 0};
+
+extern "C" {
+
+// Nanoseconds stand in for CPU cycles; only differences are ever used
+uint32_t NT_getCpuCycleCount(void) {
+    return (uint32_t) std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+// There is no screen on the host
+void NT_drawText(int x, int y, const char *str, int colour, _NT_textAlignment align, _NT_textSize size) {
+}
+
+void NT_drawShapeI(_NT_shape shape, int x0, int y0, int x1, int y1, int colour) {
+}
+
+int NT_intToString(char *buffer, int32_t value) {
+    return sprintf(buffer, "%d", (int) value);
+}
+
+int NT_floatToString(char *buffer, float value, int decimalPlaces) {
+    return sprintf(buffer, "%.*f", decimalPlaces, value);
+}
+
+int32_t NT_algorithmIndex(const _NT_algorithm *algorithm) {
+    return 0;
+}
+
+uint32_t NT_parameterOffset(void) {
+    return 0;
+}
+
+// The host tools call the algorithm directly rather than through parameters,
+// so trigger parameters that reset themselves have nothing to reset
+void NT_setParameterFromUi(uint32_t algorithmIndex, uint32_t parameter, int16_t value) {
+}
+
+// MIDI goes nowhere, but is counted so a tool can check what was sent, and
+// note ons less note offs give the notes still sounding
+long hostMidiMessages = 0;
+long hostMidiNotesSounding = 0;
+
+void NT_sendMidiByte(uint32_t destination, uint8_t byte) {
+    hostMidiMessages++;
+}
+
+void NT_sendMidi2ByteMessage(uint32_t destination, uint8_t byte0, uint8_t byte1) {
+    hostMidiMessages++;
+}
+
+void NT_sendMidi3ByteMessage(uint32_t destination, uint8_t byte0, uint8_t byte1, uint8_t byte2) {
+    hostMidiMessages++;
+    if ((byte0 & 0xF0) == 0x90 && byte2 > 0) hostMidiNotesSounding++;
+    if ((byte0 & 0xF0) == 0x80 || ((byte0 & 0xF0) == 0x90 && byte2 == 0)) hostMidiNotesSounding--;
+}
+
+}
+
+// Presets aren't saved on the host; the JSON calls do nothing
+void _NT_jsonStream::openArray() {}
+void _NT_jsonStream::closeArray() {}
+void _NT_jsonStream::openObject() {}
+void _NT_jsonStream::closeObject() {}
+void _NT_jsonStream::addMemberName(const char *name) {}
+void _NT_jsonStream::addNumber(int value) {}
+void _NT_jsonStream::addNumber(float value) {}
+void _NT_jsonStream::addString(const char *str) {}
+void _NT_jsonStream::addBoolean(bool value) {}
+
+bool _NT_jsonParse::numberOfObjectMembers(int &num) { return false; }
+bool _NT_jsonParse::numberOfArrayElements(int &num) { return false; }
+bool _NT_jsonParse::matchName(const char *name) { return false; }
+bool _NT_jsonParse::skipMember() { return false; }
+bool _NT_jsonParse::number(int &value) { return false; }
+bool _NT_jsonParse::number(float &value) { return false; }
+bool _NT_jsonParse::boolean(bool &value) { return false; }
+bool _NT_jsonParse::string(const char *&str) { return false; }
+
+// One plugin instance with its own memory and parameter values, built through
+// the factory the same way the module builds it. Instances share nothing, so
+// each thread of a host tool can own one. Specifications that aren't given
+// take their defaults.
+struct HostInstance {
+    const _NT_factory *factory;
+    std::vector<int32_t> specifications;
+    _NT_algorithmRequirements req;
+    std::vector<uint64_t> sram, dram, dtc, itc; // uint64_t keeps the blocks aligned
+    std::vector<int16_t> v;
+    _NT_algorithm *algorithm;
+
+    explicit HostInstance(std::initializer_list<int32_t> given = {}) {
+        factory = (const _NT_factory *) pluginEntry(kNT_selector_factoryInfo, 0);
+        for (uint32_t i = 0; i < factory->numSpecifications; i++) {
+            specifications.push_back(i < given.size() ? given.begin()[i] : factory->specifications[i].def);
+        }
+        factory->calculateRequirements(req, specifications.data());
+        sram.resize(req.sram / 8 + 1);
+        dram.resize(req.dram / 8 + 1);
+        dtc.resize(req.dtc / 8 + 1);
+        itc.resize(req.itc / 8 + 1);
+
+        v.resize(req.numParameters);
+        for (uint32_t i = 0; i < req.numParameters; i++) v[i] = parameters[i].def;
+
+        // The module fills in the parameter values before construct() runs
+        ((_NT_algorithm *) sram.data())->v = v.data();
+        _NT_algorithmMemoryPtrs ptrs = {(uint8_t *) sram.data(), (uint8_t *) dram.data(),
+                                        (uint8_t *) dtc.data(), (uint8_t *) itc.data()};
+        algorithm = factory->construct(ptrs, req, specifications.data());
+        algorithm->v = v.data();
+    }
+
+    HostInstance(const HostInstance &) = delete;
+    HostInstance &operator=(const HostInstance &) = delete;
+
+    // Sets a parameter and notifies the algorithm, as a UI or CV change would
+    void setParameter(int p, int16_t value) {
+        v[p] = value;
+        if (factory->parameterChanged) factory->parameterChanged(algorithm, p);
+    }
+
+    void step(float *busFrames, int numFrames) {
+        factory->step(algorithm, busFrames, numFrames / 4);
+    }
+};
+
+#endif // DNB_SEQ_NT_HOST_H
@@ -0,0 +1,371 @@
+/*
+MIT License
+
+Copyright (c) 2025 Thorinside
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Offline renderer: runs step() as fast as the host allows on a synthetic or
+// file-supplied clock, following a chain of patterns and seeds, and writes the
+// kick, snare, hi-hat, ghost snare and open hat outputs to one multichannel
+// 32-bit float WAV.
+//
+// Each chain entry starts on a bar boundary with its own instance, so entries
+// render in parallel and the result doesn't depend on the thread count.
+//
+//   render --chain 0:8,3:4@1234,... [--bpm B | --clock FILE] [--duration S]
+//          [--param N=V ...] [--seed S] [--threads N] --out FILE.wav
+
+#include "../dnb_seq.cpp"
+#include "nt_host.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <thread>
+
+// Gate outputs in WAV channel order, and the busses they are rendered to
+static const int kRenderOutputs[kNumTracks] = {
+    kParamKickOutput, kParamSnareOutput, kParamHihatOutput, kParamGhostSnareOutput, kParamOpenHatOutput,
+};
+const int kRenderClockBus = 1;
+const int kRenderOpenHatBus = 19;
+const int kRenderChannels = kNumTracks;
+
+const int kPulsesPerQuarter = 24; // Six pulses per 16th step
+const float kClockPulseMs = 1.0f;
+
+// --- Chain ---
+
+struct ChainEntry {
+    int pattern;
+    int bars;
+    bool hasSeed;
+    int seed;
+};
+
+// One chain entry placed on the clock: pulses [firstPulse, endPulse)
+struct Segment {
+    ChainEntry entry;
+    int index;
+    long long firstPulse;
+    long long endPulse;
+};
+
+static bool parseChain(const char *text, std::vector<ChainEntry> &chain) {
+    while (*text) {
+        ChainEntry e = {0, 1, false, 0};
+        int used = 0;
+        if (sscanf(text, "%d:%d%n", &e.pattern, &e.bars, &used) != 2) return false;
+        text += used;
+        if (*text == '@') {
+            if (sscanf(text + 1, "%d%n", &e.seed, &used) != 1) return false;
+            e.hasSeed = true;
+            text += 1 + used;
+        }
+        if (e.pattern < 0 || e.pattern >= NUM_BUILTIN_PATTERNS || e.bars < 1) return false;
+        chain.push_back(e);
+        if (*text == ',') text++;
+        else if (*text) return false;
+    }
+    return !chain.empty();
+}
+
+// Clock pulse times in seconds, one per line
+static bool loadClock(const char *path, std::vector<long long> &pulses) {
+    FILE *f = fopen(path, "r");
+    if (!f) return false;
+    double seconds;
+    while (fscanf(f, "%lf", &seconds) == 1) {
+        long long sample = (long long) (seconds * kHostSampleRate + 0.5);
+        if (!pulses.empty() && sample <= pulses.back()) {
+            fclose(f);
+            return false;
+        }
+        pulses.push_back(sample);
+    }
+    fclose(f);
+    return !pulses.empty();
+}
+
+// Lays the chain out over the clock, repeating it until the pulses run out
+static std::vector<Segment> layOutChain(const std::vector<ChainEntry> &chain, long long numPulses) {
+    std::vector<Segment> segments;
+    long long pulse = 0;
+    for (int i = 0; pulse < numPulses; i++) {
+        const ChainEntry &e = chain[i % chain.size()];
+        DrumPattern p;
+        buildPattern(e.pattern, p);
+        long long pulses = (long long) e.bars * p.steps * (kPulsesPerQuarter / 4);
+        segments.push_back({e, i, pulse, std::min(pulse + pulses, numPulses)});
+        pulse += pulses;
+    }
+    return segments;
+}
+
+// --- Rendering ---
+
+struct RenderSettings {
+    std::vector<std::pair<int, int>> params;
+    int baseSeed = 1;
+    int tailSamples = 0;
+};
+
+struct RenderedSegment {
+    long long firstSample;
+    std::vector<float> frames; // Interleaved, the segment plus its gate tail
+};
+
+// Renders one segment on a fresh instance. The clock stops at the segment end
+// but rendering carries on for the tail, so gates still open there finish.
+static void renderSegment(const Segment &segment, const std::vector<long long> &pulses,
+                          const RenderSettings &settings, long long totalSamples, RenderedSegment &out) {
+    HostInstance instance;
+    _DnbSeqAlgorithm *alg = (_DnbSeqAlgorithm *) instance.algorithm;
+    for (const auto &param : settings.params) instance.setParameter(param.first, param.second);
+    instance.setParameter(kParamOpenHatOutput, kRenderOpenHatBus);
+
+    // Unseeded entries still roll probabilities from a repeatable seed
+    alg->seedRandom(settings.baseSeed + segment.index);
+    alg->generatePattern(segment.entry.pattern);
+    if (segment.entry.hasSeed) alg->generateVariationWithSeed(segment.entry.seed);
+    alg->beginBar();
+
+    const long long start = pulses[segment.firstPulse];
+    const long long clockEnd = segment.endPulse < (long long) pulses.size() ? pulses[segment.endPulse] : totalSamples;
+    const long long end = std::min(clockEnd + settings.tailSamples, totalSamples);
+    const int pulseSamples = (int) (kClockPulseMs * kHostSampleRate / 1000.0f);
+
+    out.firstSample = start;
+    out.frames.assign((size_t) (end - start) * kRenderChannels, 0.0f);
+
+    const int blockFrames = kHostMaxFramesPerStep;
+    std::vector<float> busses(kHostNumBusses * blockFrames);
+    long long nextPulse = segment.firstPulse;
+
+    for (long long blockStart = start; blockStart < end; blockStart += blockFrames) {
+        const int frames = (int) std::min<long long>(blockFrames, end - blockStart);
+        const int busFrames = (frames + 3) / 4 * 4;
+        float *clockBus = busses.data() + (kRenderClockBus - 1) * busFrames;
+        std::fill(busses.begin(), busses.end(), 0.0f);
+
+        // Clock pulses are high for 1ms, or half the gap to the next pulse
+        for (long long p = nextPulse; p < segment.endPulse && pulses[p] < blockStart + frames; p++) {
+            long long width = pulseSamples;
+            if (p + 1 < (long long) pulses.size()) width = std::min(width, std::max(1LL, (pulses[p + 1] - pulses[p]) / 2));
+            for (long long s = std::max(pulses[p], blockStart); s < std::min(pulses[p] + width, blockStart + frames); s++) {
+                clockBus[s - blockStart] = 5.0f;
+            }
+        }
+        // Keep pulses still high from the previous block, drop finished ones
+        while (nextPulse < segment.endPulse && pulses[nextPulse] + pulseSamples <= blockStart + frames) nextPulse++;
+
+        instance.step(busses.data(), busFrames);
+
+        float *dst = out.frames.data() + (size_t) (blockStart - start) * kRenderChannels;
+        for (int channel = 0; channel < kRenderChannels; channel++) {
+            const float *src = busses.data() + (instance.v[kRenderOutputs[channel]] - 1) * busFrames;
+            for (int i = 0; i < frames; i++) dst[i * kRenderChannels + channel] = src[i];
+        }
+    }
+}
+
+// --- WAV Output ---
+
+static void put16(FILE *f, uint16_t v) {
+    fputc(v & 0xFF, f);
+    fputc(v >> 8, f);
+}
+
+static void put32(FILE *f, uint32_t v) {
+    put16(f, v & 0xFFFF);
+    put16(f, v >> 16);
+}
+
+// WAVE_FORMAT_EXTENSIBLE header for 32-bit float, needed above two channels
+static void writeWavHeader(FILE *f, uint32_t numFrames) {
+    const uint32_t dataBytes = numFrames * kRenderChannels * 4;
+    fwrite("RIFF", 1, 4, f);
+    put32(f, 4 + 8 + 40 + 8 + dataBytes);
+    fwrite("WAVEfmt ", 1, 8, f);
+    put32(f, 40);
+    put16(f, 0xFFFE);
+    put16(f, kRenderChannels);
+    put32(f, kHostSampleRate);
+    put32(f, kHostSampleRate * kRenderChannels * 4);
+    put16(f, kRenderChannels * 4);
+    put16(f, 32);
+    put16(f, 22);
+    put16(f, 32);
+    put32(f, 0); // No speaker positions; these are CV channels
+    static const uint8_t kFloatGuid[16] = {0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00,
+                                           0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71};
+    fwrite(kFloatGuid, 1, 16, f);
+    fwrite("data", 1, 4, f);
+    put32(f, dataBytes);
+}
+
+// --- Command Line ---
+
+static void usage() {
+    fprintf(stderr,
+            "usage: render --chain P:BARS[@SEED],... --out FILE.wav [options]\n"
+            "  --chain ...      patterns to play in order, repeated to the end;\n"
+            "                   @SEED plays a seeded variation of the pattern\n"
+            "  --bpm B          synthetic clock tempo at %d ppqn (default 174)\n"
+            "  --clock FILE     clock pulse times in seconds, one per line\n"
+            "  --duration S     seconds to render (default 60, or the clock file)\n"
+            "  --param N=V      set parameter index N to V; may be repeated\n"
+            "  --seed S         seed for probability rolls (default 1)\n"
+            "  --threads N      worker threads (default: all cores)\n"
+            "channels: kick, snare, hi-hat, ghost snare, open hat\n",
+            kPulsesPerQuarter);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    std::vector<ChainEntry> chain;
+    RenderSettings settings;
+    double bpm = 174.0;
+    double duration = -1.0;
+    const char *clockPath = nullptr;
+    const char *outPath = nullptr;
+    int numThreads = (int) std::thread::hardware_concurrency();
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (i + 1 >= argc) usage();
+        const char *value = argv[++i];
+        if (!strcmp(arg, "--chain")) {
+            if (!parseChain(value, chain)) usage();
+        } else if (!strcmp(arg, "--bpm")) {
+            bpm = atof(value);
+        } else if (!strcmp(arg, "--clock")) {
+            clockPath = value;
+        } else if (!strcmp(arg, "--duration")) {
+            duration = atof(value);
+        } else if (!strcmp(arg, "--param")) {
+            int p, v;
+            if (sscanf(value, "%d=%d", &p, &v) != 2 || p < 0 || p >= (int) ARRAY_SIZE(parameters)) usage();
+            if (v < parameters[p].min || v > parameters[p].max) usage();
+            settings.params.push_back({p, v});
+        } else if (!strcmp(arg, "--seed")) {
+            settings.baseSeed = atoi(value);
+        } else if (!strcmp(arg, "--threads")) {
+            numThreads = atoi(value);
+        } else if (!strcmp(arg, "--out")) {
+            outPath = value;
+        } else {
+            usage();
+        }
+    }
+    if (chain.empty() || !outPath || bpm <= 0.0) usage();
+    if (numThreads < 1) numThreads = 1;
+
+    // Clock pulses as sample positions
+    std::vector<long long> pulses;
+    long long totalSamples;
+    if (clockPath) {
+        if (!loadClock(clockPath, pulses)) {
+            fprintf(stderr, "%s: expected increasing pulse times in seconds\n", clockPath);
+            return 1;
+        }
+        totalSamples = duration > 0.0 ? (long long) (duration * kHostSampleRate) : pulses.back() + kHostSampleRate;
+        while (!pulses.empty() && pulses.back() >= totalSamples) pulses.pop_back();
+    } else {
+        totalSamples = (long long) ((duration > 0.0 ? duration : 60.0) * kHostSampleRate);
+        const double samplesPerPulse = kHostSampleRate * 60.0 / (bpm * kPulsesPerQuarter);
+        for (long long p = 0; (long long) (p * samplesPerPulse + 0.5) < totalSamples; p++) {
+            pulses.push_back((long long) (p * samplesPerPulse + 0.5));
+        }
+    }
+    if (pulses.empty()) usage();
+    if ((uint64_t) totalSamples * kRenderChannels * 4 > 0xFFFFFFFFu - 64) {
+        fprintf(stderr, "render is too long for one WAV file\n");
+        return 1;
+    }
+
+    // Gates can ring past the segment end by up to the open hat gate length
+    int openHatGateMs = parameters[kParamOpenHatGate].def;
+    for (const auto &param : settings.params) {
+        if (param.first == kParamOpenHatGate) openHatGateMs = param.second;
+    }
+    settings.tailSamples = (openHatGateMs + 10) * kHostSampleRate / 1000 + kHostMaxFramesPerStep;
+
+    const std::vector<Segment> segments = layOutChain(chain, (long long) pulses.size());
+
+    FILE *out = fopen(outPath, "wb");
+    if (!out) {
+        perror(outPath);
+        return 1;
+    }
+    writeWavHeader(out, (uint32_t) totalSamples);
+
+    // Render a batch of segments in parallel, then mix their tails into the
+    // following audio and write the batch in order. Batches keep memory use
+    // flat however long the set is.
+    const auto start = std::chrono::steady_clock::now();
+    const size_t batchSize = (size_t) numThreads * 2;
+    std::vector<float> carry; // Frames from tails that reach past what's written
+    long long written = 0;
+
+    // Silence before the first pulse
+    std::vector<float> silence((size_t) pulses[0] * kRenderChannels, 0.0f);
+    fwrite(silence.data(), sizeof(float), silence.size(), out);
+    written = pulses[0];
+
+    for (size_t first = 0; first < segments.size(); first += batchSize) {
+        const size_t count = std::min(batchSize, segments.size() - first);
+        std::vector<RenderedSegment> rendered(count);
+        std::atomic<size_t> next(0);
+
+        std::vector<std::thread> workers;
+        for (int t = 0; t < numThreads && t < (int) count; t++) {
+            workers.emplace_back([&]() {
+                for (size_t i; (i = next++) < count;) {
+                    renderSegment(segments[first + i], pulses, settings, totalSamples, rendered[i]);
+                }
+            });
+        }
+        for (std::thread &worker : workers) worker.join();
+
+        for (size_t i = 0; i < count; i++) {
+            RenderedSegment &r = rendered[i];
+            const long long segmentEnd = first + i + 1 < segments.size()
+                                             ? pulses[segments[first + i + 1].firstPulse]
+                                             : totalSamples;
+            // Gates are 0V or 5V, so overlapping tails combine with max()
+            for (size_t j = 0; j < carry.size() && j < r.frames.size(); j++) {
+                r.frames[j] = std::max(r.frames[j], carry[j]);
+            }
+            const size_t own = (size_t) (segmentEnd - r.firstSample) * kRenderChannels;
+            fwrite(r.frames.data(), sizeof(float), own, out);
+            written = segmentEnd;
+            carry.assign(r.frames.begin() + own, r.frames.end());
+        }
+    }
+    fclose(out);
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const double audioSeconds = (double) written / kHostSampleRate;
+    fprintf(stderr, "%zu segments, %.1f s of audio in %.2f s on %d threads (%.0fx realtime)\n",
+            segments.size(), audioSeconds, seconds, numThreads, audioSeconds / seconds);
+    return 0;
+}
@@ -0,0 +1,317 @@
+/*
+MIT License
+
+Copyright (c) 2025 Thorinside
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Replayer for the event recorder: loads the "recording" a preset saved after
+// Export Recording was triggered, restores the snapshot it starts from and runs the same
+// clock and reset edges, parameter changes and UI input through step(). The
+// steps and RNG seeds the replay produces are checked against the recorded
+// ones, and the first difference is reported.
+//
+//   replay PRESET.json [--trace]
+
+#include "../dnb_seq.cpp"
+#include "nt_host.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+
+const int kReplayPulseSamples = 24; // Clock and reset edges are replayed as 0.5ms pulses
+const int kReplayResetBus = kHostNumBusses; // Carries the resets when Reset In isn't routed
+
+struct ReplayEvent {
+    long long time; // Samples since the snapshot
+    int type;
+    int index;
+    int32_t value;
+};
+
+// --- Preset Reading ---
+
+// Reads the integer array member `name`, searching from `from`. The preset is
+// only scanned, not fully parsed; the recorder's arrays hold plain integers.
+static bool readArray(const std::string &text, size_t from, const char *name, std::vector<long long> &out) {
+    const size_t key = text.find(std::string("\"") + name + "\"", from);
+    if (key == std::string::npos) return false;
+    size_t pos = text.find('[', key);
+    if (pos == std::string::npos) return false;
+    const char *p = text.c_str() + pos + 1;
+    for (;;) {
+        while (*p == ' ' || *p == ',' || *p == '\n' || *p == '\r' || *p == '\t') p++;
+        if (*p == ']') return true;
+        char *end;
+        long long value = strtoll(p, &end, 10);
+        if (end == p) return false;
+        out.push_back(value);
+        p = end;
+    }
+}
+
+static bool loadFile(const char *path, std::string &text) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+    char buffer[65536];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0) text.append(buffer, n);
+    fclose(f);
+    return true;
+}
+
+// --- Replay ---
+
+static void printStep(long long time, int step, int fired) {
+    printf("%10lld  step %2d ", time, step + 1);
+    for (int track = 0; track < kNumTracks; track++) {
+        if (fired & (1 << track)) printf(" %s", enumStringsTracks[track]);
+    }
+    printf("\n");
+}
+
+static bool isChecked(int type) {
+    return type == kEventStep || type == kEventSeed;
+}
+
+static void usage() {
+    fprintf(stderr, "usage: replay PRESET.json [--trace]\n");
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    const char *path = nullptr;
+    bool trace = false;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--trace")) trace = true;
+        else if (!path) path = argv[i];
+        else usage();
+    }
+    if (!path) usage();
+
+    std::string text;
+    if (!loadFile(path, text)) {
+        perror(path);
+        return 1;
+    }
+    const size_t recording = text.find("\"recording\"");
+    std::vector<long long> sampleRate, v, dtcWords, bank, raw;
+    if (recording == std::string::npos || !readArray(text, recording, "v", v) ||
+        !readArray(text, recording, "dtc", dtcWords) || !readArray(text, recording, "bank", bank) ||
+        !readArray(text, recording, "events", raw)) {
+        fprintf(stderr, "%s: no recording found; trigger Export Recording, then save the preset\n", path);
+        return 1;
+    }
+    const size_t rateKey = text.find("\"sampleRate\"", recording);
+    if (rateKey == std::string::npos || atoi(text.c_str() + text.find(':', rateKey) + 1) != kHostSampleRate) {
+        fprintf(stderr, "%s: only %d Hz recordings can be replayed\n", path, kHostSampleRate);
+        return 1;
+    }
+    if (v.size() != ARRAY_SIZE(parameters) || dtcWords.size() * 4 != sizeof(_DnbSeqAlgorithm_DTC) ||
+        bank.size() != 2 + PATTERN_BANK_SIZE * (1 + kNumTracks) || raw.size() % 4 != 0) {
+        fprintf(stderr, "%s: recording was made by a different build of the plugin\n", path);
+        return 1;
+    }
+
+    // Restore the snapshot; mutations and density ranks are rebuilt from the
+    // base pattern
+    HostInstance instance({kMaxRecorderSize});
+    _DnbSeqAlgorithm *alg = (_DnbSeqAlgorithm *) instance.algorithm;
+    for (size_t p = 0; p < v.size(); p++) instance.v[p] = (int16_t) v[p];
+    for (size_t i = 0; i < dtcWords.size(); i++) {
+        int32_t word = (int32_t) dtcWords[i];
+        memcpy((uint8_t *) alg->dtc + i * 4, &word, sizeof(word));
+    }
+    alg->bankCount = (int) bank[0];
+    alg->bankNext = (int) bank[1];
+    for (int i = 0; i < PATTERN_BANK_SIZE; i++) {
+        DrumPattern &p = alg->library[NUM_BUILTIN_PATTERNS + i];
+        p.steps = (int) bank[2 + i * (1 + kNumTracks)];
+        for (int track = 0; track < kNumTracks; track++) {
+            p.hits[track] = (uint32_t) bank[3 + i * (1 + kNumTracks) + track];
+        }
+    }
+    alg->buildMutations();
+    alg->buildDensityRanks();
+
+    // MIDI clock, the internal clock and a sync leader were recorded as the
+    // clock and reset edges they made, so the replay always runs from the CV
+    // inputs, with a bus for the resets. The recorded clock source is kept
+    // for the right encoder button, which taps tempo on the internal clock.
+    int clockSource = instance.v[kParamClockSource];
+    instance.v[kParamClockSource] = kClockCv;
+    instance.v[kParamSyncMode] = kSyncOff;
+    if (instance.v[kParamResetInput] == 0) instance.v[kParamResetInput] = kReplayResetBus;
+
+    // The replay records itself, which gives the steps to compare
+    instance.v[kParamRecorder] = 1;
+    alg->startRecording();
+    alg->selectStepVariant();
+
+    const uint32_t startSample = alg->dtc->sampleCount;
+    std::vector<ReplayEvent> events;
+    for (size_t i = 0; i < raw.size(); i += 4) {
+        events.push_back({(long long) (uint32_t) ((uint32_t) raw[i] - startSample), (int) raw[i + 1],
+                          (int) raw[i + 2], (int32_t) raw[i + 3]});
+    }
+    std::stable_sort(events.begin(), events.end(), [](const ReplayEvent &a, const ReplayEvent &b) {
+        return a.time < b.time;
+    });
+
+    // Edges become pulses; UI and parameter events apply at the start of the
+    // block they were recorded before, so blocks are split there
+    std::vector<long long> clockEdges, resetEdges, controlTimes;
+    for (const ReplayEvent &e : events) {
+        if (e.type == kEventClock) clockEdges.push_back(e.time);
+        else if (e.type == kEventReset) resetEdges.push_back(e.time);
+        else if (!isChecked(e.type)) controlTimes.push_back(e.time);
+    }
+    const long long end = (events.empty() ? 0 : events.back().time) + kHostSampleRate;
+
+    const int blockFrames = kHostMaxFramesPerStep;
+    std::vector<float> busses(kHostNumBusses * blockFrames);
+    float pots[3] = {0.0f, 0.0f, 0.0f};
+    int densityCv = alg->dtc->densityCv;
+    size_t nextEvent = 0, nextControl = 0, nextClock = 0, nextReset = 0;
+
+    auto drawPulses = [](float *bus, const std::vector<long long> &edges, size_t &next, long long t, int frames) {
+        while (next < edges.size() && edges[next] + kReplayPulseSamples <= t) next++;
+        for (size_t e = next; e < edges.size() && edges[e] < t + frames; e++) {
+            long long high = kReplayPulseSamples;
+            if (e + 1 < edges.size()) high = std::min(high, edges[e + 1] - edges[e] - 1);
+            for (long long s = std::max(edges[e], t); s < std::min(edges[e] + high, t + frames); s++) {
+                bus[s - t] = 5.0f;
+            }
+        }
+    };
+
+    for (long long t = 0; t < end;) {
+        for (; nextEvent < events.size() && events[nextEvent].time <= t; nextEvent++) {
+            const ReplayEvent &e = events[nextEvent];
+            switch (e.type) {
+                case kEventParameter:
+                    if (e.index == kParamClockSource) clockSource = e.value;
+                    if (e.index == kParamRecorder || e.index == kParamClockSource || e.index == kParamSyncMode ||
+                        e.index >= (int) v.size()) {
+                        break;
+                    }
+                    instance.setParameter(e.index, (int16_t) (e.index == kParamResetInput && e.value == 0
+                                                                  ? kReplayResetBus : e.value));
+                    break;
+                case kEventPot:
+                    memcpy(&pots[e.index], &e.value, sizeof(float));
+                    break;
+                case kEventUi: {
+                    _NT_uiData data;
+                    memcpy(data.pots, pots, sizeof(pots));
+                    data.controls = (uint16_t) e.value;
+                    data.lastButtons = (uint16_t) e.index;
+                    data.encoders[0] = (int8_t) (e.value >> 16);
+                    data.encoders[1] = (int8_t) (e.value >> 24);
+                    if (clockSource == kClockInternal) {
+                        // A tap only moved the clock, whose edges are replayed
+                        data.controls &= ~kNT_encoderButtonR;
+                        data.lastButtons &= ~kNT_encoderButtonR;
+                    }
+                    instance.factory->customUi(alg, data);
+                    break;
+                }
+                case kEventDensityCv:
+                    densityCv = e.value;
+                    break;
+                case kEventSync:
+                    // A follower jumped to its leader's position
+                    alg->dtc->orderIndex = e.index;
+                    alg->dtc->currentStep = alg->dtc->stepOrder[e.index];
+                    alg->dtc->pulseCount = e.value & 0xFF;
+                    alg->dtc->barCount = e.value >> 8;
+                    alg->dtc->lookaheadState = kLookaheadIdle;
+                    break;
+                case kEventCapture:
+                    // Capture inputs aren't recorded, only the hits they added
+                    alg->dtc->currentPattern.hits[e.index] |= 1u << e.value;
+                    alg->buildSliceMap();
+                    break;
+            }
+        }
+        while (nextControl < controlTimes.size() && controlTimes[nextControl] <= t) nextControl++;
+
+        long long blockEnd = std::min(t + blockFrames, end);
+        if (nextControl < controlTimes.size()) blockEnd = std::min(blockEnd, controlTimes[nextControl]);
+        const int frames = std::max(4, (int) (blockEnd - t) / 4 * 4);
+
+        std::fill(busses.begin(), busses.end(), 0.0f);
+        drawPulses(busses.data() + (instance.v[kParamClockInput] - 1) * frames, clockEdges, nextClock, t, frames);
+        if (instance.v[kParamResetInput] > 0) {
+            drawPulses(busses.data() + (instance.v[kParamResetInput] - 1) * frames, resetEdges, nextReset, t, frames);
+        }
+        if (instance.v[kParamDensityInput] > 0) {
+            // Half a tenth away from zero, so the plugin truncates back to densityCv
+            const float volts = (densityCv + (densityCv < 0 ? -0.5f : 0.5f)) / 10.0f;
+            std::fill_n(busses.data() + (instance.v[kParamDensityInput] - 1) * frames, frames, volts);
+        }
+
+        instance.step(busses.data(), frames);
+        t += frames;
+    }
+
+    // Compare what the replay did with what was recorded
+    const EventRecorder *replayed = alg->recorder;
+    if (replayed->writeIndex > replayed->eventMask + 1) {
+        fprintf(stderr, "replay overflowed its recorder; only the start was checked\n");
+    }
+    std::vector<ReplayEvent> expected, actual;
+    for (const ReplayEvent &e : events) {
+        if (isChecked(e.type)) expected.push_back(e);
+    }
+    for (uint32_t n = 0; n < replayed->writeIndex && n <= replayed->eventMask; n++) {
+        const RecordedEvent &e = replayed->events[n];
+        if (isChecked(e.type)) {
+            actual.push_back({(long long) (uint32_t) (e.sample - startSample), e.type, e.index, e.value});
+        }
+    }
+
+    int steps = 0;
+    for (size_t i = 0; i < expected.size(); i++) {
+        const ReplayEvent &want = expected[i];
+        if (i >= actual.size() || actual[i].time != want.time || actual[i].type != want.type ||
+            actual[i].index != want.index || actual[i].value != want.value) {
+            printf("diverged at sample %lld after %d matching steps\n", want.time, steps);
+            if (want.type == kEventStep) {
+                printf("recorded:");
+                printStep(want.time, want.index, want.value);
+            }
+            if (i < actual.size() && actual[i].type == kEventStep) {
+                printf("replayed:");
+                printStep(actual[i].time, actual[i].index, actual[i].value);
+            } else if (i >= actual.size()) {
+                printf("replayed: nothing\n");
+            }
+            return 2;
+        }
+        if (want.type == kEventStep) {
+            if (trace) printStep(want.time, want.index, want.value);
+            steps++;
+        }
+    }
+    printf("%zu events replayed, %d steps match the recording\n", events.size(), steps);
+    return 0;
+}
@@ -0,0 +1,404 @@
+/*
+MIT License
+
+Copyright (c) 2025 Thorinside
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Variation explorer: sweeps seeds x patterns x probability settings through
+// generateVariationWithSeed() on every core and writes each distinct result as
+// CSV, with how often it came up, the first seed that makes it, and groove
+// metrics. A per-setting summary on stderr shows how balanced the results are.
+//
+//   variation_explorer [--seeds N] [--start S] [--patterns A-B]
+//                      [--levels p,p,...] [--grid] [--threads N] [--out FILE]
+
+#include "../dnb_seq.cpp"
+#include "nt_host.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+// --- Sweep Definition ---
+
+// Kick, snare and ghost probabilities, as set by the three pots
+struct ProbabilitySetting {
+    float kick;
+    float snare;
+    float ghost;
+};
+
+struct Sweep {
+    long long numSeeds = 1000000;
+    long long firstSeed = 0;
+    std::vector<int> patterns;
+    std::vector<ProbabilitySetting> settings;
+
+    uint64_t numJobs() const {
+        return (uint64_t) numSeeds * patterns.size() * settings.size();
+    }
+};
+
+// One job is one seed for one pattern and setting. Seeds are innermost, so a
+// run of jobs keeps the same base pattern and probabilities.
+struct Job {
+    int pattern;
+    int setting;
+    int seed;
+};
+
+static Job decodeJob(const Sweep &sweep, uint64_t index) {
+    uint64_t config = index / sweep.numSeeds;
+    Job job;
+    job.seed = (int) (sweep.firstSeed + (long long) (index % sweep.numSeeds));
+    job.setting = (int) (config % sweep.settings.size());
+    job.pattern = sweep.patterns[config / sweep.settings.size()];
+    return job;
+}
+
+// --- Results ---
+
+struct ResultKey {
+    int pattern;
+    int setting;
+    DrumPattern variation;
+
+    bool operator==(const ResultKey &other) const {
+        return pattern == other.pattern && setting == other.setting &&
+               samePattern(variation, other.variation);
+    }
+};
+
+struct ResultKeyHash {
+    size_t operator()(const ResultKey &key) const {
+        uint64_t h = 1469598103934665603ULL; // FNV-1a
+        uint32_t words[kNumTracks + 2] = {(uint32_t) key.pattern, (uint32_t) key.setting};
+        for (int track = 0; track < kNumTracks; track++) words[track + 2] = key.variation.hits[track];
+        for (uint32_t w : words) {
+            h ^= w;
+            h *= 1099511628211ULL;
+        }
+        return (size_t) h;
+    }
+};
+
+struct Tally {
+    long long count;
+    int firstSeed;
+};
+
+typedef std::unordered_map<ResultKey, Tally, ResultKeyHash> ResultMap;
+
+static void addResult(ResultMap &results, const ResultKey &key, long long count, int seed) {
+    auto it = results.find(key);
+    if (it == results.end()) {
+        results.emplace(key, Tally{count, seed});
+    } else {
+        it->second.count += count;
+        if (seed < it->second.firstSeed) it->second.firstSeed = seed;
+    }
+}
+
+// --- Work-Stealing Pool ---
+
+// Each worker owns a range of job indices. It takes small chunks from the
+// front of its own range and, once that is empty, steals the back half of the
+// largest range left, so all cores stay busy to the end of the sweep.
+const uint64_t kChunkJobs = 512;
+
+struct WorkRange {
+    std::mutex lock;
+    uint64_t begin = 0;
+    uint64_t end = 0;
+};
+
+static bool takeChunk(WorkRange &range, uint64_t &begin, uint64_t &end) {
+    std::lock_guard<std::mutex> guard(range.lock);
+    if (range.begin >= range.end) return false;
+    begin = range.begin;
+    end = std::min(range.end, begin + kChunkJobs);
+    range.begin = end;
+    return true;
+}
+
+static bool stealWork(std::vector<WorkRange> &ranges, int self) {
+    // Pick the victim with the most work left. It may shrink before we lock
+    // it again, which only costs another look.
+    int victim = -1;
+    uint64_t most = 0;
+    for (int i = 0; i < (int) ranges.size(); i++) {
+        if (i == self) continue;
+        std::lock_guard<std::mutex> guard(ranges[i].lock);
+        if (ranges[i].begin < ranges[i].end && ranges[i].end - ranges[i].begin > most) {
+            most = ranges[i].end - ranges[i].begin;
+            victim = i;
+        }
+    }
+    if (victim < 0) return false;
+
+    uint64_t begin, end;
+    {
+        std::lock_guard<std::mutex> guard(ranges[victim].lock);
+        if (ranges[victim].begin >= ranges[victim].end) return true; // Raced; look again
+        uint64_t left = ranges[victim].end - ranges[victim].begin;
+        end = ranges[victim].end;
+        begin = end - (left + 1) / 2;
+        ranges[victim].end = begin;
+    }
+    std::lock_guard<std::mutex> guard(ranges[self].lock);
+    ranges[self].begin = begin;
+    ranges[self].end = end;
+    return true;
+}
+
+static void runWorker(const Sweep &sweep, std::vector<WorkRange> &ranges, int self,
+                      ResultMap &results, std::atomic<uint64_t> &jobsDone) {
+    HostInstance instance;
+    _DnbSeqAlgorithm *alg = (_DnbSeqAlgorithm *) instance.algorithm;
+    int loadedPattern = -1;
+    int loadedSetting = -1;
+
+    for (;;) {
+        uint64_t begin, end;
+        if (!takeChunk(ranges[self], begin, end)) {
+            if (!stealWork(ranges, self)) break;
+            continue;
+        }
+
+        for (uint64_t index = begin; index < end; index++) {
+            Job job = decodeJob(sweep, index);
+            if (job.pattern != loadedPattern) {
+                alg->generatePattern(job.pattern);
+                loadedPattern = job.pattern;
+            }
+            if (job.setting != loadedSetting) {
+                const ProbabilitySetting &s = sweep.settings[job.setting];
+                alg->dtc->bdProbability = s.kick;
+                alg->dtc->snareProbability = s.snare;
+                alg->dtc->ghostProbability = s.ghost;
+                loadedSetting = job.setting;
+            }
+
+            alg->generateVariationWithSeed(job.seed);
+            addResult(results, ResultKey{job.pattern, job.setting, alg->dtc->currentPattern}, 1, job.seed);
+        }
+        jobsDone += end - begin;
+    }
+}
+
+// --- Output ---
+
+static void writeTrack(FILE *out, uint32_t hits, int steps) {
+    fputc(',', out);
+    for (int step = 0; step < steps; step++) fputc((hits & (1u << step)) ? 'x' : '.', out);
+}
+
+static int totalHits(const DrumPattern &p) {
+    const uint32_t allSteps = stepsMask(p.steps);
+    int n = 0;
+    for (int track = 0; track < kNumTracks; track++) n += countHits(p.hits[track] & allSteps);
+    return n;
+}
+
+static void writeResults(FILE *out, const Sweep &sweep, const std::vector<std::pair<ResultKey, Tally>> &rows) {
+    fprintf(out, "pattern,kick_prob,snare_prob,ghost_prob,count,frequency,first_seed,"
+                 "kick,snare,hihat,ghost,open_hat,hits,syncopation,distance\n");
+    for (const auto &row : rows) {
+        const ResultKey &key = row.first;
+        const ProbabilitySetting &s = sweep.settings[key.setting];
+        DrumPattern base;
+        buildPattern(key.pattern, base);
+
+        fprintf(out, "%s,%.3f,%.3f,%.3f,%lld,%.6f,%d", enumStringsPatterns[key.pattern],
+                s.kick, s.snare, s.ghost, row.second.count,
+                (double) row.second.count / sweep.numSeeds, row.second.firstSeed);
+        for (int track = 0; track < kNumTracks; track++) writeTrack(out, key.variation.hits[track], key.variation.steps);
+        fprintf(out, ",%d,%d,%d\n", totalHits(key.variation), syncopation(key.variation),
+                patternDistance(base, key.variation));
+    }
+}
+
+// Per pattern and setting: how many distinct results, how often the base came
+// back unchanged, and the entropy of the result distribution. Evenness is the
+// entropy over its maximum for that many results; 1.0 is perfectly balanced.
+static void writeSummary(const Sweep &sweep, const std::vector<std::pair<ResultKey, Tally>> &rows) {
+    fprintf(stderr, "%-16s %5s %5s %5s %9s %9s %8s %8s\n",
+            "pattern", "kick", "snare", "ghost", "distinct", "unchanged", "entropy", "evenness");
+
+    size_t i = 0;
+    while (i < rows.size()) {
+        const ResultKey &key = rows[i].first;
+        DrumPattern base;
+        buildPattern(key.pattern, base);
+
+        int distinct = 0;
+        long long unchanged = 0;
+        double entropy = 0;
+        for (; i < rows.size() && rows[i].first.pattern == key.pattern && rows[i].first.setting == key.setting; i++) {
+            double p = (double) rows[i].second.count / sweep.numSeeds;
+            entropy -= p * std::log2(p);
+            if (samePattern(rows[i].first.variation, base)) unchanged = rows[i].second.count;
+            distinct++;
+        }
+
+        const ProbabilitySetting &s = sweep.settings[key.setting];
+        fprintf(stderr, "%-16s %5.2f %5.2f %5.2f %9d %8.2f%% %8.3f %8.3f\n",
+                enumStringsPatterns[key.pattern], s.kick, s.snare, s.ghost, distinct,
+                100.0 * unchanged / sweep.numSeeds, entropy,
+                distinct > 1 ? entropy / std::log2((double) distinct) : 1.0);
+    }
+}
+
+// --- Command Line ---
+
+static void usage() {
+    fprintf(stderr,
+            "usage: variation_explorer [options]\n"
+            "  --seeds N        seeds per pattern and setting (default 1000000)\n"
+            "  --start S        first seed (default 0)\n"
+            "  --patterns A-B   pattern indices to sweep (default 0-%d)\n"
+            "  --levels p,...   probability levels (default 0.25,0.5,0.75,1)\n"
+            "  --grid           sweep every kick/snare/ghost combination of levels\n"
+            "                   instead of setting all three pots to each level\n"
+            "  --threads N      worker threads (default: all cores)\n"
+            "  --out FILE       CSV output (default stdout)\n",
+            NUM_BUILTIN_PATTERNS - 1);
+    exit(1);
+}
+
+static std::vector<float> parseLevels(const char *text) {
+    std::vector<float> levels;
+    char *end;
+    for (;;) {
+        float level = strtof(text, &end);
+        if (end == text || level < 0.0f || level > 1.0f) usage();
+        levels.push_back(level);
+        if (*end != ',') break;
+        text = end + 1;
+    }
+    if (*end != 0) usage();
+    return levels;
+}
+
+int main(int argc, char **argv) {
+    Sweep sweep;
+    std::vector<float> levels = {0.25f, 0.5f, 0.75f, 1.0f};
+    bool grid = false;
+    int firstPattern = 0;
+    int lastPattern = NUM_BUILTIN_PATTERNS - 1;
+    int numThreads = (int) std::thread::hardware_concurrency();
+    const char *outPath = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!strcmp(arg, "--grid")) {
+            grid = true;
+            continue;
+        }
+        if (!value) usage();
+        i++;
+        if (!strcmp(arg, "--seeds")) {
+            sweep.numSeeds = atoll(value);
+        } else if (!strcmp(arg, "--start")) {
+            sweep.firstSeed = atoll(value);
+        } else if (!strcmp(arg, "--patterns")) {
+            if (sscanf(value, "%d-%d", &firstPattern, &lastPattern) == 1) lastPattern = firstPattern;
+        } else if (!strcmp(arg, "--levels")) {
+            levels = parseLevels(value);
+        } else if (!strcmp(arg, "--threads")) {
+            numThreads = atoi(value);
+        } else if (!strcmp(arg, "--out")) {
+            outPath = value;
+        } else {
+            usage();
+        }
+    }
+    if (sweep.numSeeds < 1 || sweep.firstSeed < 0 || sweep.firstSeed + sweep.numSeeds - 1 > 0x7FFFFFFF) usage();
+    if (firstPattern < 0 || lastPattern >= NUM_BUILTIN_PATTERNS || firstPattern > lastPattern) usage();
+    if (numThreads < 1) numThreads = 1;
+
+    for (int p = firstPattern; p <= lastPattern; p++) sweep.patterns.push_back(p);
+    for (float kick : levels) {
+        if (!grid) {
+            sweep.settings.push_back({kick, kick, kick});
+            continue;
+        }
+        for (float snare : levels) {
+            for (float ghost : levels) sweep.settings.push_back({kick, snare, ghost});
+        }
+    }
+
+    FILE *out = outPath ? fopen(outPath, "w") : stdout;
+    if (!out) {
+        perror(outPath);
+        return 1;
+    }
+
+    // Split the jobs evenly to start with; stealing evens out the rest
+    const uint64_t numJobs = sweep.numJobs();
+    std::vector<WorkRange> ranges(numThreads);
+    for (int t = 0; t < numThreads; t++) {
+        ranges[t].begin = numJobs * t / numThreads;
+        ranges[t].end = numJobs * (t + 1) / numThreads;
+    }
+
+    std::vector<ResultMap> threadResults(numThreads);
+    std::atomic<uint64_t> jobsDone(0);
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < numThreads; t++) {
+        workers.emplace_back(runWorker, std::cref(sweep), std::ref(ranges), t,
+                             std::ref(threadResults[t]), std::ref(jobsDone));
+    }
+    for (std::thread &worker : workers) worker.join();
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Merge; counts add up and the lowest seed wins, so the output doesn't
+    // depend on the thread count
+    ResultMap merged;
+    for (const ResultMap &results : threadResults) {
+        for (const auto &entry : results) addResult(merged, entry.first, entry.second.count, entry.second.firstSeed);
+    }
+
+    std::vector<std::pair<ResultKey, Tally>> rows(merged.begin(), merged.end());
+    std::sort(rows.begin(), rows.end(), [](const std::pair<ResultKey, Tally> &a, const std::pair<ResultKey, Tally> &b) {
+        if (a.first.pattern != b.first.pattern) return a.first.pattern < b.first.pattern;
+        if (a.first.setting != b.first.setting) return a.first.setting < b.first.setting;
+        if (a.second.count != b.second.count) return a.second.count > b.second.count;
+        return a.second.firstSeed < b.second.firstSeed;
+    });
+
+    writeResults(out, sweep, rows);
+    if (out != stdout) fclose(out);
+
+    writeSummary(sweep, rows);
+    fprintf(stderr, "%llu variations, %zu distinct, %.2f s on %d threads: %.1f M/s (%.2f M/s per thread)\n",
+            (unsigned long long) jobsDone.load(), rows.size(), seconds, numThreads,
+            jobsDone / seconds / 1e6, jobsDone / seconds / 1e6 / numThreads);
+    return 0;
+}
@@ -0,0 +1,581 @@
+/*
+MIT License
+
+Copyright (c) 2025 Thorinside
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Sequencer verifier: explores every step/pulse/queue state of step() for
+// every pattern length from 1 to 32 steps, every built-in pattern, pulses per
+// step from 1 to 8, every playback direction and density at 0%, 50% and 100%
+// (50% only for directions other than Forward). From each state it applies a
+// clock edge, a reset edge, both on the same sample, and a pattern change,
+// running the real step(), and checks the result against a plain reference
+// model:
+//
+//   - the step is always below the pattern length, the pulse below the
+//     pulses per step, and the step is the one the direction plays there
+//   - the Random direction's order is a shuffle of every step
+//   - a clock edge on the first pulse of a step fires exactly that step's hits
+//     at the current density, including right after a pattern change
+//   - a reset, alone or with a clock edge, returns to the first step of the
+//     order and the next clock edge fires it, so no trigger is lost
+//   - a queued pattern change applies at the next cycle start and never later
+//     than one pattern period of clock edges
+//   - a follower joining its leader mid-cycle in another bar fires what the
+//     leader fires, trig conditions included
+//
+// Any counterexample is printed with the state and event that produced it.
+// Run it after changing the hot path to check the rewrite is equivalent.
+//
+//   verify_sequencer
+
+#include "../dnb_seq.cpp"
+#include "nt_host.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+const int kVerifyResetBus = 2;
+const int kVerifyOpenHatBus = 19;
+const int kMaxPulsesPerStep = 8;
+const int kVerifyFrames = 4;
+static const int kVerifyDensities[] = {0, 50, 100};
+
+enum {
+    kEventKindClock,
+    kEventKindReset,
+    kEventKindClockAndReset,
+    kEventKindQueue, // Followed by the pattern id
+};
+
+static const char *const eventNames[] = {"clock", "reset", "clock+reset", "queue"};
+
+// The order each direction plays each length in. Random is the plugin's
+// own, checked to be a shuffle of every step.
+static std::vector<int> orders[kNumDirections][MAX_STEPS + 1];
+
+// --- Patterns Under Test ---
+
+// A current pattern: one of the built-ins, or a synthetic pattern used to
+// cover lengths no built-in has
+struct Candidate {
+    DrumPattern pattern;
+    int builtinId; // -1 for synthetic
+    // State after loading it, so each check starts without regenerating
+    _DnbSeqAlgorithm_DTC dtc;
+    _DnbSeqAlgorithm_ITC itc;
+    Mutation mutations[MAX_MUTATIONS];
+    int numMutations;
+};
+
+static DrumPattern syntheticPattern(int steps) {
+    DrumPattern p;
+    memset(&p, 0, sizeof(p));
+    p.steps = steps;
+    for (int step = 0; step < steps; step++) {
+        const uint32_t bit = 1u << step;
+        if (step % 3 == 0) p.hits[kTrackKick] |= bit;
+        if (step % 4 == 2) p.hits[kTrackSnare] |= bit;
+        p.hits[kTrackHihat] |= bit;
+        if (step % 5 == 1) p.hits[kTrackGhost] |= bit;
+        if (step % 7 == 6) p.hits[kTrackOpenHat] |= bit;
+    }
+    return p;
+}
+
+// Tracks the reference model expects at a step when every roll passes: the
+// pattern's hits that rank within the density threshold plus the extra hits
+// it adds. With the open hat routed it chokes the closed hat. Unrouted, the
+// hat step is a single decision on the hi-hat output: the hi-hat lane's
+// where it has a hit, and the open hat lane's only where it has none.
+static uint32_t expectedFired(const DrumPattern &pattern, const _DnbSeqAlgorithm_ITC &itc, int threshold, int step,
+                              bool openHatRouted) {
+    uint32_t fired = 0;
+    for (int track = 0; track < kNumTracks; track++) {
+        const bool hit = pattern.hits[track] & (1u << step);
+        if (hit ? itc.hitRank[track][step] <= threshold : itc.addRank[track][step] <= threshold) {
+            fired |= 1u << track;
+        }
+    }
+    const uint32_t openHat = (fired >> kTrackOpenHat) & 1u;
+    if (openHatRouted) {
+        fired &= ~(openHat << kTrackHihat);
+    } else {
+        const uint32_t hatLane = (pattern.hits[kTrackHihat] >> step) & 1u;
+        fired = (fired | (openHat & ~hatLane) << kTrackHihat) & ~(1u << kTrackOpenHat);
+    }
+    return fired;
+}
+
+// --- Reference Model ---
+
+// The steps a direction plays, in order
+static std::vector<int> buildOrder(int direction, int steps) {
+    std::vector<int> order;
+    switch (direction) {
+        case kDirectionReverse:
+            for (int step = steps - 1; step >= 0; step--) order.push_back(step);
+            break;
+        case kDirectionPingPong:
+            for (int step = 0; step < steps; step++) order.push_back(step);
+            for (int step = steps - 2; step >= 1; step--) order.push_back(step);
+            break;
+        case kDirectionOddEven:
+            for (int step = 0; step < steps; step++) {
+                if (step % 2 == 0) order.push_back(step);
+            }
+            for (int step = 0; step < steps; step++) {
+                if (step % 2 == 1) order.push_back(step);
+            }
+            break;
+        default:
+            for (int step = 0; step < steps; step++) order.push_back(step);
+            break;
+    }
+    return order;
+}
+
+static const std::vector<int> &referenceOrder(int direction, int steps) {
+    return orders[direction][steps];
+}
+
+// Candidates 0-9 are the built-in patterns, in id order
+struct ModelState {
+    int candidate;
+    int index; // Place in the order
+    int pulse;
+    int queued; // Pattern id, -1 for none
+};
+
+static int modelStep(const std::vector<Candidate> &candidates, const ModelState &m, int direction) {
+    return referenceOrder(direction, candidates[m.candidate].pattern.steps)[m.index];
+}
+
+static void startCycle(ModelState &m) {
+    if (m.queued >= 0) {
+        m.candidate = m.queued;
+        m.queued = -1;
+    }
+}
+
+// Applies one event to the model; returns the tracks that fire
+static uint32_t modelEvent(const std::vector<Candidate> &candidates, ModelState &m, int kind, int queueId,
+                           int pulsesPerStep, int direction, int threshold) {
+    if (kind == kEventKindQueue) {
+        m.queued = queueId;
+        return 0;
+    }
+    if (kind == kEventKindReset || kind == kEventKindClockAndReset) {
+        m.index = 0;
+        m.pulse = 0;
+        startCycle(m);
+    }
+    if (kind == kEventKindReset) return 0;
+
+    uint32_t fired = 0;
+    m.pulse++;
+    if (m.pulse == 1) {
+        const Candidate &c = candidates[m.candidate];
+        fired = expectedFired(c.pattern, c.itc, threshold, modelStep(candidates, m, direction), true);
+    }
+    if (m.pulse == pulsesPerStep) {
+        m.pulse = 0;
+        m.index = (m.index + 1) % (int) referenceOrder(direction, candidates[m.candidate].pattern.steps).size();
+        if (m.index == 0) startCycle(m);
+    }
+    return fired;
+}
+
+// --- Driving the Plugin ---
+
+// Where the checks start from
+struct StartState {
+    int candidate;
+    int direction;
+    int index; // Place in the order
+    int pulse;
+    int pulsesPerStep;
+    int queued;
+    int density; // Percent
+};
+
+struct Verifier {
+    HostInstance instance;
+    _DnbSeqAlgorithm *alg;
+    std::vector<Candidate> candidates;
+    std::vector<float> busses;
+    long long transitions = 0;
+    long long states = 0;
+
+    Verifier() : busses(kHostNumBusses * kVerifyFrames) {
+        alg = (_DnbSeqAlgorithm *) instance.algorithm;
+        instance.setParameter(kParamResetInput, kVerifyResetBus);
+        instance.setParameter(kParamOpenHatOutput, kVerifyOpenHatBus);
+
+        for (int id = 0; id < NUM_BUILTIN_PATTERNS; id++) {
+            Candidate c;
+            c.builtinId = id;
+            buildPattern(id, c.pattern);
+            candidates.push_back(c);
+        }
+        for (int steps = 1; steps <= MAX_STEPS; steps++) {
+            Candidate c;
+            c.builtinId = -1;
+            c.pattern = syntheticPattern(steps);
+            candidates.push_back(c);
+        }
+        for (Candidate &c : candidates) {
+            if (c.builtinId >= 0) {
+                alg->generatePattern(c.builtinId);
+            } else {
+                alg->dtc->basePattern = c.pattern;
+                alg->dtc->currentPattern = c.pattern;
+                alg->buildMutations();
+                alg->buildDensityRanks();
+            }
+            alg->updateConditions();
+            c.dtc = *alg->dtc;
+            c.itc = *alg->itc;
+            memcpy(c.mutations, alg->mutations, sizeof(c.mutations));
+            c.numMutations = alg->numMutations;
+        }
+
+        instance.v[kParamDirection] = kDirectionRandom;
+        for (int steps = 1; steps <= MAX_STEPS; steps++) {
+            for (int direction = 0; direction < kNumDirections; direction++) {
+                orders[direction][steps] = buildOrder(direction, steps);
+            }
+            alg->dtc->currentPattern.steps = steps;
+            alg->buildStepOrder();
+            std::vector<int> &shuffle = orders[kDirectionRandom][steps];
+            shuffle.assign(alg->dtc->stepOrder, alg->dtc->stepOrder + alg->dtc->orderLength);
+            std::vector<int> sorted = shuffle;
+            std::sort(sorted.begin(), sorted.end());
+            if (sorted != orders[kDirectionForward][steps]) {
+                printf("FAILED: the Random order for %d steps is not a shuffle of every step\n", steps);
+                exit(1);
+            }
+        }
+        instance.v[kParamDirection] = kDirectionForward;
+    }
+
+    static int threshold(int density) {
+        return density * kMaxDensityThreshold / 100;
+    }
+
+    void load(const StartState &s) {
+        const Candidate &c = candidates[s.candidate];
+        *alg->dtc = c.dtc;
+        *alg->itc = c.itc;
+        memcpy(alg->mutations, c.mutations, sizeof(c.mutations));
+        alg->numMutations = c.numMutations;
+        instance.v[kParamDensity] = s.density;
+        instance.v[kParamDirection] = s.direction;
+        alg->updateDensity(threshold(s.density));
+
+        // Ping-pong plays most steps twice, so the place in the order is set
+        // after building it, not found from the step
+        _DnbSeqAlgorithm_DTC *dtc = alg->dtc;
+        dtc->currentStep = referenceOrder(s.direction, c.pattern.steps)[s.index];
+        alg->buildStepOrder();
+        dtc->orderIndex = s.index;
+        dtc->pulseCount = s.pulse;
+        dtc->pulsesPerStep = s.pulsesPerStep;
+        dtc->clockHigh = false;
+        dtc->resetHigh = false;
+        dtc->patternChangeQueued = s.queued >= 0;
+        dtc->queuedPatternId = s.queued;
+        alg->clearTriggers();
+    }
+
+    // Runs one event through the plugin; returns the tracks whose gates opened
+    uint32_t event(int kind, int queueId) {
+        transitions++;
+        if (kind == kEventKindQueue) {
+            instance.setParameter(kParamPatternSelect, queueId);
+            return 0;
+        }
+        std::fill(busses.begin(), busses.end(), 0.0f);
+        if (kind != kEventKindReset) busses[(instance.v[kParamClockInput] - 1) * kVerifyFrames] = 5.0f;
+        if (kind != kEventKindClock) busses[(kVerifyResetBus - 1) * kVerifyFrames] = 5.0f;
+        instance.step(busses.data(), kVerifyFrames);
+
+        static const int outputs[kNumTracks] = {
+            kParamKickOutput, kParamSnareOutput, kParamHihatOutput, kParamGhostSnareOutput, kParamOpenHatOutput,
+        };
+        uint32_t fired = 0;
+        for (int track = 0; track < kNumTracks; track++) {
+            if (busses[(instance.v[outputs[track]] - 1) * kVerifyFrames] > 1.0f) fired |= 1u << track;
+        }
+        return fired;
+    }
+
+    bool matches(const ModelState &m, int direction) const {
+        const _DnbSeqAlgorithm_DTC *dtc = alg->dtc;
+        return dtc->orderIndex == m.index && dtc->currentStep == modelStep(candidates, m, direction) &&
+               dtc->pulseCount == m.pulse &&
+               samePattern(dtc->currentPattern, candidates[m.candidate].pattern) &&
+               dtc->patternChangeQueued == (m.queued >= 0) && (m.queued < 0 || dtc->queuedPatternId == m.queued);
+    }
+
+    void fail(const char *what, const StartState &s, int kind, int queueId) {
+        const Candidate &c = candidates[s.candidate];
+        const _DnbSeqAlgorithm_DTC *dtc = alg->dtc;
+        printf("FAILED: %s\n", what);
+        printf("  state: pattern %s (%d steps), %s, step %d (order %d), pulse %d of %d, queued %d, density %d%%\n",
+               c.builtinId >= 0 ? enumStringsPatterns[c.builtinId] : "synthetic", c.pattern.steps,
+               enumStringsDirections[s.direction], referenceOrder(s.direction, c.pattern.steps)[s.index] + 1,
+               s.index, s.pulse, s.pulsesPerStep, s.queued, s.density);
+        printf("  event: %s", eventNames[kind]);
+        if (kind == kEventKindQueue) printf(" %d", queueId);
+        printf("\n  after: step %d of %d (order %d), pulse %d, queued %d\n", dtc->currentStep + 1,
+               dtc->currentPattern.steps, dtc->orderIndex, dtc->pulseCount,
+               dtc->patternChangeQueued ? dtc->queuedPatternId : -1);
+        exit(1);
+    }
+
+    // Calls check() for every start state
+    template<typename Check>
+    void forEachState(Check check) {
+        StartState s;
+        for (s.direction = 0; s.direction < kNumDirections; s.direction++) {
+            for (s.candidate = 0; s.candidate < (int) candidates.size(); s.candidate++) {
+                const int length = (int) referenceOrder(s.direction, candidates[s.candidate].pattern.steps).size();
+                for (s.pulsesPerStep = 1; s.pulsesPerStep <= kMaxPulsesPerStep; s.pulsesPerStep++) {
+                    for (s.index = 0; s.index < length; s.index++) {
+                        for (s.pulse = 0; s.pulse < s.pulsesPerStep; s.pulse++) {
+                            for (s.queued = -1; s.queued < NUM_BUILTIN_PATTERNS; s.queued++) {
+                                for (int density : kVerifyDensities) {
+                                    if (s.direction != kDirectionForward && density != 50) continue;
+                                    s.density = density;
+                                    check(s);
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // One transition from a state, against the reference model
+    void checkTransition(const StartState &s, int kind, int queueId) {
+        load(s);
+        ModelState m = {s.candidate, s.index, s.pulse, s.queued};
+        const uint32_t want = modelEvent(candidates, m, kind, queueId, s.pulsesPerStep, s.direction,
+                                         threshold(s.density));
+        const uint32_t got = event(kind, queueId);
+
+        const _DnbSeqAlgorithm_DTC *dtc = alg->dtc;
+        if (dtc->currentStep < 0 || dtc->currentStep >= dtc->currentPattern.steps) {
+            fail("step out of range", s, kind, queueId);
+        }
+        if (dtc->pulseCount < 0 || dtc->pulseCount >= s.pulsesPerStep) fail("pulse out of range", s, kind, queueId);
+        if (!matches(m, s.direction)) fail("position differs from the reference model", s, kind, queueId);
+        if (got != want) {
+            printf("  fired %02x, expected %02x\n", got, want);
+            fail("wrong triggers", s, kind, queueId);
+        }
+
+        // After a reset the very next clock edge must fire the first step
+        if (kind == kEventKindReset) {
+            const uint32_t first = event(kEventKindClock, 0);
+            const Candidate &c = candidates[m.candidate];
+            const uint32_t expected = expectedFired(c.pattern, c.itc, threshold(s.density),
+                                                    modelStep(candidates, m, s.direction), true);
+            if (first != expected) {
+                printf("  fired %02x, expected %02x\n", first, expected);
+                fail("trigger lost after reset", s, kind, queueId);
+            }
+        }
+    }
+
+    void checkTransitions() {
+        forEachState([this](const StartState &s) {
+            states++;
+            checkTransition(s, kEventKindClock, 0);
+            checkTransition(s, kEventKindReset, 0);
+            checkTransition(s, kEventKindClockAndReset, 0);
+            for (int id = 0; id < NUM_BUILTIN_PATTERNS; id++) checkTransition(s, kEventKindQueue, id);
+        });
+    }
+
+    // Bounded check: a queued change applies at a cycle start within one
+    // pattern period of clock edges
+    void checkQueueLatency() {
+        forEachState([this](const StartState &s) {
+            if (s.queued < 0 || s.density != 50) return;
+            load(s);
+            const int period =
+                    (int) referenceOrder(s.direction, candidates[s.candidate].pattern.steps).size() * s.pulsesPerStep;
+            int edges = 0;
+            while (alg->dtc->patternChangeQueued && edges <= period) {
+                event(kEventKindClock, 0);
+                edges++;
+            }
+            if (alg->dtc->patternChangeQueued) {
+                fail("queued change not applied within one pattern period", s, kEventKindClock, 0);
+            }
+            if (alg->dtc->orderIndex != 0 || alg->dtc->pulseCount != 0) {
+                fail("queued change applied away from the cycle start", s, kEventKindClock, 0);
+            }
+        });
+    }
+};
+
+// With Open Hat Out and its MIDI channel unset, as in a default preset, the
+// hi-hat output plays the steps the reference model gives, which for each
+// built-in pattern are its closed hat lane, as before the open hat lane was
+// added. At Hi-hat Prob 50% each of those steps must fire half the time in
+// both dice modes: a step rolled once for each hat lane would fire 75%.
+static void checkDefaultHats() {
+    const int cycles = 4000;
+    const double bound = 5.0 * std::sqrt(0.25 / cycles);
+
+    for (int mode = kDicePerHit; mode <= kDicePerBar; mode++) {
+        HostInstance instance;
+        _DnbSeqAlgorithm *alg = (_DnbSeqAlgorithm *) instance.algorithm;
+        alg->seedRandom(1);
+        instance.setParameter(kParamHihatProbability, 50);
+        instance.setParameter(kParamDiceMode, mode);
+        std::vector<float> busses(kHostNumBusses * kVerifyFrames);
+        float *clock = &busses[(instance.v[kParamClockInput] - 1) * kVerifyFrames];
+        const float *hats = &busses[(instance.v[kParamHihatOutput] - 1) * kVerifyFrames];
+
+        for (int id = 0; id < NUM_BUILTIN_PATTERNS; id++) {
+            DrumPattern baseline;
+            buildPattern(id, baseline);
+            alg->generatePattern(id);
+            alg->dtc->pulsesPerStep = 1;
+            alg->dtc->currentStep = 0;
+            alg->dtc->orderIndex = 0;
+            alg->dtc->pulseCount = 0;
+
+            uint32_t modelled = 0;
+            for (int step = 0; step < baseline.steps; step++) {
+                const uint32_t fired = expectedFired(alg->dtc->currentPattern, *alg->itc,
+                                                     alg->dtc->densityThreshold, step, false);
+                if (fired & (1u << kTrackHihat)) modelled |= 1u << step;
+            }
+            if (modelled != baseline.hits[kTrackHihat]) {
+                printf("FAILED: with the open hat unrouted, %s models hats %08x instead of its hi-hat lane %08x\n",
+                       enumStringsPatterns[id], modelled, baseline.hits[kTrackHihat]);
+                exit(1);
+            }
+
+            int played[MAX_STEPS] = {0};
+            for (int cycle = 0; cycle < cycles; cycle++) {
+                for (int step = 0; step < baseline.steps; step++) {
+                    std::fill(busses.begin(), busses.end(), 0.0f);
+                    clock[0] = 5.0f;
+                    instance.step(busses.data(), kVerifyFrames);
+                    if (hats[0] > 1.0f) played[step]++;
+                    std::fill(busses.begin(), busses.end(), 0.0f);
+                    instance.step(busses.data(), kVerifyFrames);
+                }
+            }
+            for (int step = 0; step < baseline.steps; step++) {
+                const double rate = (double) played[step] / cycles;
+                const bool ok = (modelled & (1u << step)) ? std::fabs(rate - 0.5) <= bound : played[step] == 0;
+                if (!ok) {
+                    printf("FAILED: with the open hat unrouted and %s dice, %s step %d plays hats %.3f of the time, "
+                           "expected %.1f\n", mode == kDicePerBar ? "per bar" : "per hit", enumStringsPatterns[id],
+                           step + 1, rate, (modelled & (1u << step)) ? 0.5 : 0.0);
+                    exit(1);
+                }
+            }
+        }
+    }
+}
+
+// A follower that joins its leader mid-cycle in another bar plays that bar's
+// trig conditions from the step it joins at. With every step on 1:2, a
+// follower left on the previous bar's masks would fire the other half of
+// the bars, so its triggers must match the leader's block for block.
+static void checkFollowerBar() {
+    const int syncBus = 20;
+    const int joinBar = 3;
+    const int frames = 16; // Room for the sync packet's header and edges
+    HostInstance leader, follower;
+    leader.setParameter(kParamSyncMode, kSyncLeader);
+    leader.setParameter(kParamSyncOutput, syncBus);
+    follower.setParameter(kParamSyncMode, kSyncFollower);
+    follower.setParameter(kParamSyncInput, syncBus);
+    for (HostInstance *instance : {&leader, &follower}) {
+        _DnbSeqAlgorithm *alg = (_DnbSeqAlgorithm *) instance->algorithm;
+        memset(alg->dtc->conditions, kCond1of2, sizeof(alg->dtc->conditions));
+        alg->updateConditions();
+        alg->dtc->pulsesPerStep = 1;
+    }
+
+    std::vector<float> leaderBusses(kHostNumBusses * frames), followerBusses(kHostNumBusses * frames);
+    float *clock = &leaderBusses[(leader.v[kParamClockInput] - 1) * frames];
+    const int steps = ((_DnbSeqAlgorithm *) leader.algorithm)->dtc->currentPattern.steps;
+    const int joinStep = joinBar * steps + steps / 2;
+    for (int step = 0; step < (joinBar + 2) * steps; step++) {
+        for (int half = 0; half < 2; half++) {
+            std::fill(leaderBusses.begin(), leaderBusses.end(), 0.0f);
+            std::fill(followerBusses.begin(), followerBusses.end(), 0.0f);
+            if (half == 0) clock[0] = 5.0f;
+            leader.step(leaderBusses.data(), frames);
+            // Until it joins, the follower hears no leader and holds still
+            if (step < joinStep) continue;
+            std::copy_n(&leaderBusses[(syncBus - 1) * frames], frames,
+                        &followerBusses[(syncBus - 1) * frames]);
+            follower.step(followerBusses.data(), frames);
+            static const int outputs[kNumTracks] = {
+                kParamKickOutput, kParamSnareOutput, kParamHihatOutput, kParamGhostSnareOutput, kParamOpenHatOutput,
+            };
+            for (int track = 0; track < kNumTracks; track++) {
+                const int bus = leader.v[outputs[track]] - 1;
+                if (bus < 0) continue;
+                for (int i = 0; i < frames; i++) {
+                    if ((leaderBusses[bus * frames + i] > 1.0f) !=
+                        (followerBusses[bus * frames + i] > 1.0f)) {
+                        printf("FAILED: a follower joining at bar %d step %d plays track %d differently from its "
+                               "leader at bar %d step %d\n", joinBar + 1, steps / 2 + 1, track, step / steps + 1,
+                               step % steps + 1);
+                        exit(1);
+                    }
+                }
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1) {
+        fprintf(stderr, "usage: verify_sequencer\n");
+        return 1;
+    }
+
+    checkDefaultHats();
+    checkFollowerBar();
+
+    static Verifier verifier;
+    verifier.checkTransitions();
+    verifier.checkQueueLatency();
+    printf("%zu patterns, lengths 1-%d, 1-%d pulses per step, %d directions, %zu densities: %lld states, "
+           "%lld transitions, all invariants hold\n", verifier.candidates.size(), MAX_STEPS, kMaxPulsesPerStep,
+           kNumDirections, ARRAY_SIZE(kVerifyDensities), verifier.states, verifier.transitions);
+    return 0;
+}